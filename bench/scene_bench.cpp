@@ -0,0 +1,506 @@
+// Scene-level throughput and scaling benchmark.
+//
+// Procedurally generates scenes at increasing triangle counts, renders
+// them headless (no window) at several resolutions and thread counts,
+// and prints one CSV row per configuration to stdout.
+//
+// Usage: ./scenebench [max_count] [frames]
+//
+// Each thread rasterizes a contiguous slice of the scene into its own
+// framebuffer, so the thread columns measure how rasterizer throughput
+// scales rather than the cost of merging the results.
+//
+// The sortlast mode instead renders each slice in a worker process
+// (the threads column then counts processes, powers of two only) and
+// includes merging the slices by depth. The workers are forked once per
+// configuration, before the warm-up frame, so frames aren't charged for
+// process creation. Its first frame of every
+// configuration is checked against rendering the whole scene into one
+// span buffer, and the benchmark stops if they differ.
+//
+// pixels_per_s counts the pixels each mode writes: every pixel of every
+// triangle in direct mode, only the resolved visible spans in the span
+// modes. Each configuration runs in its own child process, so
+// peak_rss_kb is that configuration's peak rather than the process's.
+
+#include "triangle.hpp"
+#include "spanbuffer.hpp"
+#include "sortlast.hpp"
+#include "constants.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct Resolution {
+    int width;
+    int height;
+};
+
+struct SceneTri {
+    SDL_Point a;
+    SDL_Point b;
+    SDL_Point c;
+    float z;
+};
+
+enum class SceneKind {
+    soup,
+    grid,
+    slivers,
+    tiny
+};
+
+enum class RenderMode {
+    direct,
+    spans,
+    sortlast
+};
+
+static const char* scene_name(const SceneKind kind)
+{
+    switch (kind) {
+    case SceneKind::soup:
+        return "soup";
+    case SceneKind::grid:
+        return "grid";
+    case SceneKind::slivers:
+        return "slivers";
+    case SceneKind::tiny:
+        return "tiny";
+    }
+    return "unknown";
+}
+
+static const char* mode_name(const RenderMode mode)
+{
+    switch (mode) {
+    case RenderMode::direct:
+        return "direct";
+    case RenderMode::spans:
+        return "spans";
+    case RenderMode::sortlast:
+        return "sortlast";
+    }
+    return "unknown";
+}
+
+static SDL_Point clamp_point(int x, int y, const Resolution& res)
+{
+    x = std::clamp(x, 0, res.width - 1);
+    y = std::clamp(y, 0, res.height - 1);
+    return {x, y};
+}
+
+static void push_tri(std::vector<SceneTri>& tris, const SDL_Point& a, const SDL_Point& b, const SDL_Point& c, const float z)
+{
+    // Triangles whose vertices all share one row cover no area
+    if (a.y == b.y && b.y == c.y) {
+        return;
+    }
+    tris.push_back({a, b, c, z});
+}
+
+static std::vector<SceneTri> generate_scene(const SceneKind kind, const std::size_t count, const Resolution& res)
+{
+    std::mt19937 rng(static_cast<std::uint32_t>(count) ^ static_cast<std::uint32_t>(res.width));
+    std::uniform_int_distribution<int> rand_x(0, res.width - 1);
+    std::uniform_int_distribution<int> rand_y(0, res.height - 1);
+    std::uniform_real_distribution<float> rand_z(1.0f, 100.0f);
+
+    std::vector<SceneTri> tris;
+    tris.reserve(count);
+
+    switch (kind) {
+    case SceneKind::soup: {
+        // Random triangles sized so that the average depth
+        // complexity stays roughly constant as the count grows.
+        const float area_per_tri = static_cast<float>(res.width) * res.height / count;
+        const int extent = std::max(4, static_cast<int>(4.0f * std::sqrt(area_per_tri)));
+        std::uniform_int_distribution<int> offset(-extent, extent);
+        for (std::size_t i = 0; i < count; i++) {
+            const int cx = rand_x(rng);
+            const int cy = rand_y(rng);
+            push_tri(
+                tris,
+                clamp_point(cx + offset(rng), cy + offset(rng), res),
+                clamp_point(cx + offset(rng), cy + offset(rng), res),
+                clamp_point(cx + offset(rng), cy + offset(rng), res),
+                rand_z(rng)
+            );
+        }
+        break;
+    }
+    case SceneKind::grid: {
+        // Regular mesh covering the whole screen, two triangles per cell
+        const std::size_t cells = std::max<std::size_t>(1, count / 2);
+        const int cols = std::max(1, static_cast<int>(std::sqrt(cells * static_cast<float>(res.width) / res.height)));
+        const int rows = std::max<int>(1, cells / cols);
+        for (int r = 0; r < rows; r++) {
+            const int y0 = r * (res.height - 1) / rows;
+            const int y1 = (r + 1) * (res.height - 1) / rows;
+            for (int c = 0; c < cols; c++) {
+                const int x0 = c * (res.width - 1) / cols;
+                const int x1 = (c + 1) * (res.width - 1) / cols;
+                const float z = rand_z(rng);
+                push_tri(tris, {x0, y0}, {x1, y0}, {x0, y1}, z);
+                push_tri(tris, {x1, y0}, {x1, y1}, {x0, y1}, z);
+            }
+        }
+        break;
+    }
+    case SceneKind::slivers: {
+        // Long, thin triangles that are mostly setup and edge walking
+        std::uniform_int_distribution<int> length(res.height / 8, res.height / 2);
+        std::uniform_int_distribution<int> thickness(1, 3);
+        for (std::size_t i = 0; i < count; i++) {
+            const int x = rand_x(rng);
+            const int y = rand_y(rng);
+            const int len = length(rng);
+            const int t = thickness(rng);
+            if (i % 2 == 0) {
+                push_tri(tris, clamp_point(x, y, res), clamp_point(x + len, y + t, res), clamp_point(x + len, y - t, res), rand_z(rng));
+            } else {
+                push_tri(tris, clamp_point(x, y, res), clamp_point(x + t, y + len, res), clamp_point(x - t, y + len, res), rand_z(rng));
+            }
+        }
+        break;
+    }
+    case SceneKind::tiny: {
+        // Clouds of triangles covering a handful of pixels,
+        // like the tinyTri case in main.cpp
+        std::uniform_int_distribution<int> offset(0, 3);
+        for (std::size_t i = 0; i < count; i++) {
+            const int x = rand_x(rng);
+            const int y = rand_y(rng);
+            push_tri(
+                tris,
+                clamp_point(x, y, res),
+                clamp_point(x + offset(rng), y + 1 + offset(rng), res),
+                clamp_point(x + 1 + offset(rng), y + offset(rng), res),
+                rand_z(rng)
+            );
+        }
+        break;
+    }
+    }
+
+    return tris;
+}
+
+static void render_slice(
+    const std::vector<SceneTri>& tris,
+    const std::size_t first,
+    const std::size_t last,
+    const Resolution& res,
+    const RenderMode mode,
+    std::vector<std::uint32_t>& pixels,
+    SpanBuffer& spans
+) {
+    if (mode == RenderMode::direct) {
+        for (std::size_t i = first; i < last; i++) {
+            const SceneTri& t = tris[i];
+            draw_filled_triangle_bres(pixels, res.width, 0xFF000000 | static_cast<std::uint32_t>(i), t.a, t.b, t.c);
+        }
+    } else {
+        spans.clear();
+        for (std::size_t i = first; i < last; i++) {
+            const SceneTri& t = tris[i];
+            draw_filled_triangle_spans(spans, 0xFF000000 | static_cast<std::uint32_t>(i), t.z, t.a, t.b, t.c);
+        }
+        spans.resolve(pixels);
+    }
+}
+
+static double percentile(const std::vector<double>& sorted, const double p)
+{
+    const std::size_t i = static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+// Sent from the child process that ran a configuration to the parent
+struct ConfigResult {
+    bool ok;
+    std::uint64_t pixels_per_frame;
+    double mean_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    double max_ms;
+};
+
+static ConfigResult run_config(
+    const SceneKind scene,
+    const std::vector<SceneTri>& tris,
+    const Resolution& res,
+    const RenderMode mode,
+    const int num_threads,
+    const int frames
+) {
+    ConfigResult result = {};
+    std::vector<std::vector<std::uint32_t>> buffers(
+        num_threads,
+        std::vector<std::uint32_t>(static_cast<std::size_t>(res.width) * res.height)
+    );
+    std::vector<SpanBuffer> span_buffers;
+    if (mode != RenderMode::direct) {
+        span_buffers.assign(num_threads, SpanBuffer(res.width, res.height));
+    } else {
+        span_buffers.assign(num_threads, SpanBuffer(0, 0));
+    }
+
+    const std::size_t slice = (tris.size() + num_threads - 1) / num_threads;
+
+    // The workers are forked here, once per configuration, and keep
+    // their copy of the scene and span buffers for every frame
+    std::unique_ptr<SortLastRenderer> sort_last;
+    if (mode == RenderMode::sortlast) {
+        sort_last = std::make_unique<SortLastRenderer>(
+            num_threads, res.width, res.height,
+            [&](const int worker, std::uint32_t* color, float* depth) {
+                SpanBuffer& spans = span_buffers[worker];
+                spans.clear();
+                const std::size_t first = std::min(tris.size(), worker * slice);
+                const std::size_t last = std::min(tris.size(), first + slice);
+                for (std::size_t i = first; i < last; i++) {
+                    const SceneTri& t = tris[i];
+                    draw_filled_triangle_spans(spans, 0xFF000000 | static_cast<std::uint32_t>(i), t.z, t.a, t.b, t.c);
+                }
+                spans.resolve(color, depth);
+            }
+        );
+    }
+
+    auto render_frame = [&]() {
+        if (sort_last) {
+            sort_last->render(buffers[0]);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (int t = 0; t < num_threads; t++) {
+            const std::size_t first = std::min(tris.size(), t * slice);
+            const std::size_t last = std::min(tris.size(), first + slice);
+            workers.emplace_back(
+                render_slice,
+                std::cref(tris), first, last, std::cref(res), mode,
+                std::ref(buffers[t]), std::ref(span_buffers[t])
+            );
+        }
+        for (std::thread& w : workers) {
+            w.join();
+        }
+    };
+
+    // Warm-up frame so first-touch page faults aren't timed
+    render_frame();
+
+    // Pixels each mode actually writes per frame: direct mode writes
+    // every pixel of every triangle, the span modes only resolve the
+    // spans left visible in each thread's or worker's buffer
+    if (mode == RenderMode::direct) {
+        for (const SceneTri& t : tris) {
+            result.pixels_per_frame += count_filled_triangle_pixels(t.a, t.b, t.c);
+        }
+    } else if (mode == RenderMode::spans) {
+        for (const SpanBuffer& spans : span_buffers) {
+            result.pixels_per_frame += spans.pixel_count();
+        }
+    } else {
+        // The workers' span buffers live in their own processes
+        SpanBuffer spans(res.width, res.height);
+        for (int w = 0; w < num_threads; w++) {
+            spans.clear();
+            const std::size_t first = std::min(tris.size(), w * slice);
+            const std::size_t last = std::min(tris.size(), first + slice);
+            for (std::size_t i = first; i < last; i++) {
+                const SceneTri& t = tris[i];
+                draw_filled_triangle_spans(spans, 0xFF000000 | static_cast<std::uint32_t>(i), t.z, t.a, t.b, t.c);
+            }
+            result.pixels_per_frame += spans.pixel_count();
+        }
+    }
+
+    if (sort_last) {
+        std::vector<std::uint32_t> expected(buffers[0].size(), COLOR_BLANK.raw);
+        SpanBuffer all(res.width, res.height);
+        render_slice(tris, 0, tris.size(), res, RenderMode::spans, expected, all);
+        if (expected != buffers[0]) {
+            std::fprintf(stderr, "sortlast: %s scene with %zu triangles at %dx%d differs from a single span buffer\n",
+                scene_name(scene), tris.size(), res.width, res.height);
+            return result;
+        }
+    }
+
+    std::vector<double> frame_ms(frames);
+    for (double& ms : frame_ms) {
+        const auto start_time = std::chrono::steady_clock::now();
+        render_frame();
+        const auto end_time = std::chrono::steady_clock::now();
+        ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    }
+
+    double total_ms = 0.0;
+    for (const double ms : frame_ms) {
+        total_ms += ms;
+    }
+    std::sort(frame_ms.begin(), frame_ms.end());
+
+    result.ok = true;
+    result.mean_ms = total_ms / frames;
+    result.p50_ms = percentile(frame_ms, 0.50);
+    result.p95_ms = percentile(frame_ms, 0.95);
+    result.p99_ms = percentile(frame_ms, 0.99);
+    result.max_ms = frame_ms.back();
+    return result;
+}
+
+// Runs one configuration in a child process, so that its peak resident
+// set is measured on its own rather than as the running maximum of
+// every configuration before it. The child starts from the parent's
+// resident set at fork(), which includes the scene.
+static bool run_config_isolated(
+    const SceneKind scene,
+    const std::vector<SceneTri>& tris,
+    const Resolution& res,
+    const RenderMode mode,
+    const int num_threads,
+    const int frames,
+    ConfigResult& result,
+    long& peak_rss_kb
+) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::perror("pipe");
+        return false;
+    }
+    std::fflush(stdout);
+    const pid_t pid = fork();
+    if (pid < 0) {
+        std::perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        ConfigResult child_result = {};
+        try {
+            child_result = run_config(scene, tris, res, mode, num_threads, frames);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+        }
+        const bool sent = write(fds[1], &child_result, sizeof(child_result)) == static_cast<ssize_t>(sizeof(child_result));
+        // Skip the parent's atexit handlers and static destructors
+        _exit(sent && child_result.ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    const bool received = read(fds[0], &result, sizeof(result)) == static_cast<ssize_t>(sizeof(result));
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) {
+        std::perror("wait4");
+        return false;
+    }
+#ifdef __APPLE__
+    // macOS reports bytes, Linux reports kilobytes
+    peak_rss_kb = usage.ru_maxrss / 1024;
+#else
+    peak_rss_kb = usage.ru_maxrss;
+#endif
+    return received && result.ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t max_count = 10000000;
+    int frames = 10;
+    if (argc > 1) {
+        max_count = std::strtoull(argv[1], nullptr, 10);
+    }
+    if (argc > 2) {
+        frames = std::max(1, std::atoi(argv[2]));
+    }
+
+    static constexpr SceneKind scenes[] = {
+        SceneKind::soup,
+        SceneKind::grid,
+        SceneKind::slivers,
+        SceneKind::tiny
+    };
+    static constexpr RenderMode modes[] = {
+        RenderMode::direct,
+        RenderMode::spans,
+        RenderMode::sortlast
+    };
+    static constexpr Resolution resolutions[] = {
+        {640, 360},
+        {1280, 720},
+        {1920, 1080}
+    };
+    std::vector<int> thread_counts = {1, 2, 4};
+    const int hw_threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (hw_threads > 4) {
+        thread_counts.push_back(hw_threads);
+    }
+
+    std::printf(
+        "scene,mode,triangles,width,height,threads,frames,"
+        "tris_per_s,pixels_per_s,frame_ms_mean,frame_ms_p50,frame_ms_p95,frame_ms_p99,frame_ms_max,peak_rss_kb\n"
+    );
+
+    for (const SceneKind scene : scenes) {
+        for (std::size_t count = 1000; count <= max_count; count *= 10) {
+            for (const Resolution& res : resolutions) {
+                const std::vector<SceneTri> tris = generate_scene(scene, count, res);
+
+                for (const RenderMode mode : modes) {
+                    for (const int num_threads : thread_counts) {
+                        if (mode == RenderMode::sortlast && (num_threads & (num_threads - 1)) != 0) {
+                            continue;
+                        }
+                        ConfigResult result;
+                        long peak_rss_kb = 0;
+                        if (!run_config_isolated(scene, tris, res, mode, num_threads, frames, result, peak_rss_kb)) {
+                            return 1;
+                        }
+
+                        std::printf(
+                            "%s,%s,%zu,%d,%d,%d,%d,%.0f,%.0f,%.3f,%.3f,%.3f,%.3f,%.3f,%ld\n",
+                            scene_name(scene),
+                            mode_name(mode),
+                            tris.size(),
+                            res.width,
+                            res.height,
+                            num_threads,
+                            frames,
+                            tris.size() / (result.mean_ms / 1000.0),
+                            result.pixels_per_frame / (result.mean_ms / 1000.0),
+                            result.mean_ms,
+                            result.p50_ms,
+                            result.p95_ms,
+                            result.p99_ms,
+                            result.max_ms,
+                            peak_rss_kb
+                        );
+                        std::fflush(stdout);
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include "pixelformat.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// Framebuffer whose storage and fill kernels are specialized
+// at compile time for one pixel format, so inner loops never
+// branch on the format.
+template <typename Format>
+class Framebuffer {
+public:
+    using pixel_type = typename Format::pixel_type;
+
+    std::vector<pixel_type> pixels;
+
+    Framebuffer(const int width, const int height)
+        : pixels(static_cast<std::size_t>(width) * height), w(width), h(height)
+    {
+    }
+
+    int width() const { return w; }
+    int height() const { return h; }
+    int pitch() const { return w * static_cast<int>(sizeof(pixel_type)); }
+
+    // Fills the inclusive range [x0, x1] on row y.
+    void fill_span(const int y, const int x0, const int x1, const std::uint32_t argb)
+    {
+        pixel_type* row = pixels.data() + static_cast<std::size_t>(y) * w;
+        if constexpr (Format::dither_period == 1) {
+            std::fill(row + x0, row + x1 + 1, Format::encode(argb, x0, y));
+        } else {
+            // The dither pattern repeats every dither_period pixels,
+            // so encode one period and tile it across the span.
+            static_assert(Format::dither_period == 4, "fill_span assumes a 4-pixel dither period");
+            pixel_type pattern[4];
+            for (int i = 0; i < 4; i++) {
+                pattern[i] = Format::encode(argb, i, y);
+            }
+            for (int x = x0; x <= x1; x++) {
+                row[x] = pattern[x & 3];
+            }
+        }
+    }
+
+    void clear(const std::uint32_t argb)
+    {
+        for (int y = 0; y < h; y++) {
+            fill_span(y, 0, w - 1, argb);
+        }
+    }
+
+    // Expands the framebuffer back to ARGB8888, e.g. for dumping or upscaling.
+    void to_argb8888(std::vector<std::uint32_t>& out) const
+    {
+        out.resize(pixels.size());
+        std::transform(pixels.begin(), pixels.end(), out.begin(), Format::decode);
+    }
+
+private:
+    int w;
+    int h;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "frameloop.hpp"
+#include <algorithm>
+#include <SDL2/SDL.h>
+
+// Largest amount of real time a single frame may feed into
+// the update accumulator, so a long stall can't cause a
+// spiral of catch-up updates.
+constexpr double MAX_FRAME_SECONDS = 0.25;
+
+// Sleeping is only accurate to a millisecond or two,
+// so the last part of each wait is spent spinning.
+constexpr double SPIN_SECONDS = 0.002;
+
+// Returns true if the loop should quit
+static bool poll_events(const std::function<void(int)>& on_key)
+{
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_QUIT) {
+            return true;
+        }
+        if (event.type == SDL_KEYDOWN) {
+            if (event.key.keysym.sym == SDLK_ESCAPE) {
+                return true;
+            }
+            if (on_key) {
+                on_key(event.key.keysym.sym);
+            }
+        }
+    }
+    return false;
+}
+
+void run_frame_loop(
+    const FrameLoopConfig& config,
+    FrameStats& stats,
+    const std::function<void(double)>& update,
+    const std::function<void(double)>& render,
+    const std::function<void(int)>& on_key
+) {
+    const double ticks_per_second = static_cast<double>(SDL_GetPerformanceFrequency());
+    const double step = 1.0 / config.update_hz;
+    const double frame_period = config.target_fps > 0.0 ? 1.0 / config.target_fps : 0.0;
+
+    auto seconds_since = [&](const Uint64 start) {
+        return (SDL_GetPerformanceCounter() - start) / ticks_per_second;
+    };
+
+    const Uint64 loop_start = SDL_GetPerformanceCounter();
+    Uint64 prev_frame_start = loop_start;
+    double next_deadline = frame_period;
+    double accumulator = 0.0;
+
+    while (!poll_events(on_key)) {
+        const Uint64 frame_start = SDL_GetPerformanceCounter();
+        const double frame_seconds = (frame_start - prev_frame_start) / ticks_per_second;
+        prev_frame_start = frame_start;
+        if (frame_seconds > 0.0) {
+            stats.add(frame_seconds * 1000.0);
+        }
+
+        accumulator += std::min(frame_seconds, MAX_FRAME_SECONDS);
+        while (accumulator >= step) {
+            update(step);
+            accumulator -= step;
+        }
+
+        render(accumulator / step);
+
+        if (frame_period > 0.0) {
+            // Pace against absolute deadlines so sleep error doesn't accumulate
+            double now = seconds_since(loop_start);
+            if (now > next_deadline + frame_period) {
+                // Fell more than a frame behind; don't try to catch up
+                next_deadline = now;
+            }
+            const double sleep_seconds = next_deadline - now - SPIN_SECONDS;
+            if (sleep_seconds > 0.0) {
+                SDL_Delay(static_cast<Uint32>(sleep_seconds * 1000.0));
+            }
+            while (now < next_deadline) {
+                now = seconds_since(loop_start);
+            }
+            next_deadline += frame_period;
+        }
+    }
+}
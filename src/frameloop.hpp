@@ -0,0 +1,28 @@
+#ifndef FRAMELOOP_H
+#define FRAMELOOP_H
+
+#include "framestats.hpp"
+#include <functional>
+
+struct FrameLoopConfig {
+    // Rate of the fixed-timestep update callback
+    double update_hz = 60.0;
+    // Frames per second to pace rendering to; 0 renders as fast as possible
+    double target_fps = 0.0;
+};
+
+// Runs a continuous frame loop until the window is closed or Escape is pressed.
+// Events are polled without blocking, update() is called with a fixed
+// timestep (in seconds) as many times as needed to catch up with real time,
+// and render() is called once per frame with the fraction of a timestep
+// left over, for interpolation. Frame-to-frame times are added to stats.
+// Other key presses are passed to on_key, if given.
+void run_frame_loop(
+    const FrameLoopConfig& config,
+    FrameStats& stats,
+    const std::function<void(double)>& update,
+    const std::function<void(double)>& render,
+    const std::function<void(int)>& on_key = nullptr
+);
+
+#endif
@@ -0,0 +1,292 @@
+#include "framesink.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+FrameSink::FrameSink(
+    const std::string& path,
+    const StreamFormat format,
+    const int width,
+    const int height,
+    const int fps,
+    const std::size_t ring_size
+)
+    : file(nullptr),
+      owns_file(path != "-"),
+      format(format),
+      width(width),
+      height(height),
+      ring(ring_size, std::vector<std::uint32_t>(static_cast<std::size_t>(width) * height)),
+      head(0),
+      tail(0),
+      stopping(false),
+      written(0),
+      dropped(0),
+      failed(false),
+      stall_count(0),
+      stall_total_ms(0.0)
+{
+    if (format != StreamFormat::argb && (width % 2 != 0 || height % 2 != 0)) {
+        throw std::runtime_error("FrameSink: 4:2:0 output needs an even width and height");
+    }
+
+    file = owns_file ? std::fopen(path.c_str(), "wb") : stdout;
+    if (file == nullptr) {
+        throw std::runtime_error("FrameSink: could not open " + path);
+    }
+
+    if (format == StreamFormat::y4m) {
+        std::fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n", width, height, fps);
+    }
+
+    writer = std::thread(&FrameSink::writer_loop, this);
+}
+
+FrameSink::~FrameSink()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    not_empty.notify_one();
+    writer.join();
+
+    std::fflush(file);
+    if (owns_file) {
+        std::fclose(file);
+    }
+}
+
+void FrameSink::submit(const std::vector<std::uint32_t>& pixels)
+{
+    if (failed) {
+        throw std::runtime_error("FrameSink: write failed");
+    }
+
+    std::size_t slot;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (head - tail == ring.size()) {
+            // Back-pressure: the writer hasn't freed a buffer yet
+            const auto start_time = std::chrono::steady_clock::now();
+            not_full.wait(lock, [&] { return head - tail < ring.size(); });
+            const auto end_time = std::chrono::steady_clock::now();
+            stall_count++;
+            stall_total_ms += std::chrono::duration<double, std::milli>(end_time - start_time).count();
+        }
+        slot = head % ring.size();
+    }
+
+    // The slot belongs to this thread until head is advanced
+    std::copy(pixels.begin(), pixels.begin() + ring[slot].size(), ring[slot].begin());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        head++;
+    }
+    not_empty.notify_one();
+}
+
+void FrameSink::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    not_full.wait(lock, [&] { return tail == head; });
+}
+
+void FrameSink::writer_loop()
+{
+    std::vector<std::uint8_t> yuv;
+    if (format != StreamFormat::argb) {
+        yuv.resize(static_cast<std::size_t>(width) * height * 3 / 2);
+    }
+
+    for (;;) {
+        std::size_t slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            not_empty.wait(lock, [&] { return head != tail || stopping; });
+            if (head == tail) {
+                // Stopping and drained
+                return;
+            }
+            slot = tail % ring.size();
+        }
+
+        if (failed) {
+            dropped++;
+        } else if (write_frame(ring[slot], yuv)) {
+            written++;
+        } else {
+            failed = true;
+            dropped++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tail++;
+        }
+        not_full.notify_one();
+    }
+}
+
+bool FrameSink::write_frame(const std::vector<std::uint32_t>& frame, std::vector<std::uint8_t>& yuv)
+{
+    if (format == StreamFormat::argb) {
+        return std::fwrite(frame.data(), sizeof(std::uint32_t), frame.size(), file) == frame.size();
+    }
+
+    argb_to_yuv420(frame.data(), width, height, yuv.data());
+    if (format == StreamFormat::y4m && std::fputs("FRAME\n", file) < 0) {
+        return false;
+    }
+    return std::fwrite(yuv.data(), 1, yuv.size(), file) == yuv.size();
+}
+
+std::size_t FrameSink::frames_submitted() const
+{
+    return head;
+}
+
+std::size_t FrameSink::frames_written() const
+{
+    return written;
+}
+
+std::size_t FrameSink::frames_dropped() const
+{
+    return dropped;
+}
+
+std::size_t FrameSink::stalls() const
+{
+    return stall_count;
+}
+
+double FrameSink::stall_ms() const
+{
+    return stall_total_ms;
+}
+
+// BT.601 limited range:
+// Y = (( 66 R + 129 G +  25 B + 128) >> 8) +  16
+// U = ((-38 R -  74 G + 112 B + 128) >> 8) + 128
+// V = ((112 R -  94 G -  18 B + 128) >> 8) + 128
+void argb_to_yuv420(const std::uint32_t* argb, const int width, const int height, std::uint8_t* yuv)
+{
+    std::uint8_t* y_plane = yuv;
+    std::uint8_t* u_plane = y_plane + width * height;
+    std::uint8_t* v_plane = u_plane + (width / 2) * (height / 2);
+
+    // Luma
+    for (int y = 0; y < height; y++) {
+        const std::uint32_t* src = argb + y * width;
+        std::uint8_t* dst = y_plane + y * width;
+        int x = 0;
+#if defined(__SSE2__)
+        // In memory each pixel is B, G, R, A, so widening a pixel's bytes
+        // to 16 bits and multiply-adding against (25, 129, 66, 0) gives
+        // two partial sums per pixel, which are then added together.
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i coeffs = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+        const __m128i round = _mm_set1_epi32(128);
+        for (; x + 4 <= width; x += 4) {
+            const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), coeffs);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), coeffs);
+            lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+            hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+            // Sums are in lanes 0 and 2 of each half
+            __m128i sums = _mm_castps_si128(_mm_shuffle_ps(
+                _mm_castsi128_ps(lo),
+                _mm_castsi128_ps(hi),
+                _MM_SHUFFLE(2, 0, 2, 0)
+            ));
+            sums = _mm_add_epi32(_mm_srli_epi32(_mm_add_epi32(sums, round), 8), _mm_set1_epi32(16));
+            const __m128i packed16 = _mm_packs_epi32(sums, zero);
+            const __m128i packed8 = _mm_packus_epi16(packed16, zero);
+            const int four = _mm_cvtsi128_si32(packed8);
+            std::memcpy(dst + x, &four, 4);
+        }
+#endif
+        for (; x < width; x++) {
+            const int r = (src[x] >> 16) & 0xFF;
+            const int g = (src[x] >> 8) & 0xFF;
+            const int b = src[x] & 0xFF;
+            dst[x] = static_cast<std::uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+
+    // Chroma, from the average of each 2x2 block
+    for (int y = 0; y < height / 2; y++) {
+        const std::uint32_t* row0 = argb + (2 * y) * width;
+        const std::uint32_t* row1 = row0 + width;
+        std::uint8_t* u_dst = u_plane + y * (width / 2);
+        std::uint8_t* v_dst = v_plane + y * (width / 2);
+        int x = 0;
+#if defined(__SSE2__)
+        // Four chroma samples from 8x2 pixels per pass. Channels are
+        // widened to 16 bits, the two rows added, then each pixel pair
+        // folded together, leaving one B, G, R, A sum per 2x2 block.
+        // U and V are then multiply-added like luma, with an arithmetic
+        // shift since their sums can be negative.
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        const __m128i u_coeffs = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+        const __m128i v_coeffs = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+        const __m128i round = _mm_set1_epi32(128);
+        const __m128i bias = _mm_set1_epi32(128);
+        auto pair_sums = [&](const __m128i a, const __m128i b) {
+            // a and b hold 4 pixels each from the two rows
+            const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            const __m128i lo_sum = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+            const __m128i hi_sum = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+            // Rounded average of the two 2x2 blocks, B, G, R, A each
+            return _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo_sum, hi_sum), two), 2);
+        };
+        auto chroma = [&](const __m128i avg01, const __m128i avg23, const __m128i coeffs) {
+            __m128i lo = _mm_madd_epi16(avg01, coeffs);
+            __m128i hi = _mm_madd_epi16(avg23, coeffs);
+            lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+            hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+            const __m128i sums = _mm_castps_si128(_mm_shuffle_ps(
+                _mm_castsi128_ps(lo),
+                _mm_castsi128_ps(hi),
+                _MM_SHUFFLE(2, 0, 2, 0)
+            ));
+            return _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(sums, round), 8), bias);
+        };
+        for (; x + 4 <= width / 2; x += 4) {
+            const __m128i* src0 = reinterpret_cast<const __m128i*>(row0 + 2 * x);
+            const __m128i* src1 = reinterpret_cast<const __m128i*>(row1 + 2 * x);
+            const __m128i avg01 = pair_sums(_mm_loadu_si128(src0), _mm_loadu_si128(src1));
+            const __m128i avg23 = pair_sums(_mm_loadu_si128(src0 + 1), _mm_loadu_si128(src1 + 1));
+            // U in bytes 0-3, V in bytes 4-7
+            const __m128i packed8 = _mm_packus_epi16(
+                _mm_packs_epi32(chroma(avg01, avg23, u_coeffs), chroma(avg01, avg23, v_coeffs)),
+                zero
+            );
+            const int u_four = _mm_cvtsi128_si32(packed8);
+            const int v_four = _mm_cvtsi128_si32(_mm_srli_si128(packed8, 4));
+            std::memcpy(u_dst + x, &u_four, 4);
+            std::memcpy(v_dst + x, &v_four, 4);
+        }
+#endif
+        for (; x < width / 2; x++) {
+            const std::uint32_t p0 = row0[2 * x];
+            const std::uint32_t p1 = row0[2 * x + 1];
+            const std::uint32_t p2 = row1[2 * x];
+            const std::uint32_t p3 = row1[2 * x + 1];
+            const int r = (((p0 >> 16) & 0xFF) + ((p1 >> 16) & 0xFF) + ((p2 >> 16) & 0xFF) + ((p3 >> 16) & 0xFF) + 2) >> 2;
+            const int g = (((p0 >> 8) & 0xFF) + ((p1 >> 8) & 0xFF) + ((p2 >> 8) & 0xFF) + ((p3 >> 8) & 0xFF) + 2) >> 2;
+            const int b = ((p0 & 0xFF) + (p1 & 0xFF) + (p2 & 0xFF) + (p3 & 0xFF) + 2) >> 2;
+            u_dst[x] = static_cast<std::uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v_dst[x] = static_cast<std::uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
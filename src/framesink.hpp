@@ -0,0 +1,83 @@
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class StreamFormat {
+    y4m,    // YUV4MPEG2 stream, 4:2:0 chroma
+    yuv420, // Headerless planar 4:2:0 frames
+    argb    // Headerless ARGB8888 frames, unconverted
+};
+
+// Streams finished frames to a file, or to stdout if the path is "-".
+// submit() copies each frame into a ring of preallocated buffers and
+// returns immediately; a writer thread converts and writes them out.
+// submit() only blocks when every buffer is still waiting to be
+// written, and each such stall is counted.
+class FrameSink {
+public:
+    FrameSink(
+        const std::string& path,
+        const StreamFormat format,
+        const int width,
+        const int height,
+        const int fps,
+        const std::size_t ring_size = 4
+    );
+    ~FrameSink();
+
+    FrameSink(const FrameSink&) = delete;
+    FrameSink& operator=(const FrameSink&) = delete;
+
+    void submit(const std::vector<std::uint32_t>& pixels);
+    // Blocks until every submitted frame has been written or dropped
+    void flush();
+
+    std::size_t frames_submitted() const;
+    std::size_t frames_written() const;
+    // Frames not written because a write failed, including the one
+    // that failed
+    std::size_t frames_dropped() const;
+    std::size_t stalls() const;
+    double stall_ms() const;
+
+private:
+    std::FILE* file;
+    bool owns_file;
+    StreamFormat format;
+    int width;
+    int height;
+
+    std::vector<std::vector<std::uint32_t>> ring;
+    // Monotonic counters; slot i is ring[i % ring.size()]
+    std::size_t head;
+    std::size_t tail;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+
+    std::atomic<std::size_t> written;
+    std::atomic<std::size_t> dropped;
+    std::atomic<bool> failed;
+    std::size_t stall_count;
+    double stall_total_ms;
+
+    std::thread writer;
+
+    void writer_loop();
+    bool write_frame(const std::vector<std::uint32_t>& frame, std::vector<std::uint8_t>& yuv);
+};
+
+// Converts an ARGB8888 image to planar YUV 4:2:0 (BT.601, limited range).
+// Width and height must be even. yuv must hold width * height * 3 / 2 bytes.
+void argb_to_yuv420(const std::uint32_t* argb, const int width, const int height, std::uint8_t* yuv);
+
+#endif
@@ -0,0 +1,72 @@
+#include "framestats.hpp"
+#include <algorithm>
+
+FrameStats::FrameStats(const std::size_t window)
+    : samples(window, 0.0), next(0), filled(0), total(0), worst_ever(0.0)
+{
+    sorted.reserve(window);
+}
+
+void FrameStats::add(const double frame_ms)
+{
+    samples[next] = frame_ms;
+    next = (next + 1) % samples.size();
+    filled = std::min(filled + 1, samples.size());
+    total++;
+    worst_ever = std::max(worst_ever, frame_ms);
+}
+
+std::size_t FrameStats::count() const
+{
+    return filled;
+}
+
+double FrameStats::last() const
+{
+    if (filled == 0) {
+        return 0.0;
+    }
+    return samples[(next + samples.size() - 1) % samples.size()];
+}
+
+double FrameStats::mean() const
+{
+    if (filled == 0) {
+        return 0.0;
+    }
+    double total = 0.0;
+    for (std::size_t i = 0; i < filled; i++) {
+        total += samples[i];
+    }
+    return total / filled;
+}
+
+// p is in [0, 1], e.g. 0.95 for the 95th percentile
+double FrameStats::percentile(const double p) const
+{
+    if (filled == 0) {
+        return 0.0;
+    }
+    sorted.assign(samples.begin(), samples.begin() + filled);
+    const std::size_t i = std::min(static_cast<std::size_t>(p * (filled - 1) + 0.5), filled - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + i, sorted.end());
+    return sorted[i];
+}
+
+double FrameStats::worst() const
+{
+    if (filled == 0) {
+        return 0.0;
+    }
+    return *std::max_element(samples.begin(), samples.begin() + filled);
+}
+
+std::size_t FrameStats::total_count() const
+{
+    return total;
+}
+
+double FrameStats::total_worst() const
+{
+    return worst_ever;
+}
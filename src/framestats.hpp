@@ -0,0 +1,34 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <vector>
+#include <cstddef>
+
+// Rolling frame-time statistics over the most recent frames, plus a
+// frame count and worst frame time for the whole run.
+// All times are in milliseconds.
+class FrameStats {
+public:
+    explicit FrameStats(const std::size_t window = 240);
+
+    void add(const double frame_ms);
+    // Frames in the rolling window
+    std::size_t count() const;
+    double last() const;
+    double mean() const;
+    double percentile(const double p) const;
+    double worst() const;
+    // Frames and worst frame time since construction
+    std::size_t total_count() const;
+    double total_worst() const;
+
+private:
+    std::vector<double> samples;
+    std::size_t next;
+    std::size_t filled;
+    std::size_t total;
+    double worst_ever;
+    mutable std::vector<double> sorted;
+};
+
+#endif
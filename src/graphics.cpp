@@ -2,7 +2,11 @@
 #include "constants.hpp"
 
 Graphics::Graphics()
-    : pixels(NUM_PIXELS, COLOR_BLANK.raw)
+    : pixels(NUM_PIXELS, COLOR_BLANK.raw),
+      fb_texture(nullptr),
+      fb_texture_format(0),
+      fb_texture_width(0),
+      fb_texture_height(0)
 {
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         throw std::runtime_error(SDL_GetError());
@@ -39,6 +43,9 @@ Graphics::Graphics()
 
 Graphics::~Graphics()
 {
+    if (fb_texture != nullptr) {
+        SDL_DestroyTexture(fb_texture);
+    }
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
@@ -58,3 +65,31 @@ void Graphics::render()
     render_nondestructive();
     std::fill(pixels.begin(), pixels.end(), COLOR_BLANK.raw);
 }
+
+void Graphics::present_pixels(
+    const std::uint32_t format,
+    const int width,
+    const int height,
+    const void* data,
+    const int pitch
+) {
+    // Only recreate the texture when the framebuffer layout changes
+    if (fb_texture == nullptr || format != fb_texture_format
+        || width != fb_texture_width || height != fb_texture_height) {
+        if (fb_texture != nullptr) {
+            SDL_DestroyTexture(fb_texture);
+        }
+        fb_texture = SDL_CreateTexture(renderer, format, SDL_TEXTUREACCESS_STATIC, width, height);
+        if (fb_texture == nullptr) {
+            throw std::runtime_error(SDL_GetError());
+        }
+        fb_texture_format = format;
+        fb_texture_width = width;
+        fb_texture_height = height;
+    }
+
+    SDL_RenderClear(renderer);
+    SDL_UpdateTexture(fb_texture, nullptr, data, pitch);
+    SDL_RenderCopy(renderer, fb_texture, nullptr, nullptr);
+    SDL_RenderPresent(renderer);
+}
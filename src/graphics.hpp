@@ -1,6 +1,7 @@
 #ifndef GRAPHICS_H
 #define GRAPHICS_H
 
+#include "framebuffer.hpp"
 #include <vector>
 #include <cstdint>
 #include <SDL2/SDL.h>
@@ -14,10 +15,30 @@ public:
     void render();
     void render_nondestructive();
 
+    // Presents a framebuffer in any pixel format; SDL converts it
+    // to the window's format and scales it to fill the window.
+    template <typename Format>
+    void render_framebuffer(const Framebuffer<Format>& fb)
+    {
+        present_pixels(Format::sdl_format, fb.width(), fb.height(), fb.pixels.data(), fb.pitch());
+    }
+
 private:
     SDL_Window* window;
     SDL_Renderer* renderer;
     SDL_Texture* texture;
+    SDL_Texture* fb_texture;
+    std::uint32_t fb_texture_format;
+    int fb_texture_width;
+    int fb_texture_height;
+
+    void present_pixels(
+        const std::uint32_t format,
+        const int width,
+        const int height,
+        const void* data,
+        const int pitch
+    );
 };
 
 #endif
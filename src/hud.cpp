@@ -0,0 +1,198 @@
+#include "hud.hpp"
+#include "constants.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// 5x7 bitmap font. Bit 4 of each row is the leftmost pixel.
+struct Glyph {
+    char c;
+    std::uint8_t rows[7];
+};
+
+static constexpr Glyph FONT[] = {
+    {' ', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+    {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+    {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+    {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+    {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+    {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+    {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+    {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+    {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+    {'A', {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}},
+    {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+    {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+    {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+    {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+    {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+    {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}},
+    {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+    {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+    {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+    {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}},
+    {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+    {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+    {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+    {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+    {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}},
+    {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+    {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+    {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+    {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+    {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}},
+    {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+    {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}},
+    {',', {0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}},
+    {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+    {'/', {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}},
+    {'%', {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}},
+    {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
+    {'=', {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}},
+    {'(', {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}},
+    {')', {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}}
+};
+
+constexpr int NUM_GLYPHS = sizeof(FONT) / sizeof(FONT[0]);
+
+// Each font pixel becomes a GLYPH_SCALE x GLYPH_SCALE block, and each
+// cell has one font pixel of spacing to the right and below.
+constexpr int GLYPH_SCALE = 2;
+constexpr int CELL_WIDTH = 6 * GLYPH_SCALE;
+constexpr int CELL_HEIGHT = 8 * GLYPH_SCALE;
+constexpr int ATLAS_WIDTH = NUM_GLYPHS * CELL_WIDTH;
+
+constexpr int PANEL_X = 8;
+constexpr int PANEL_Y = 8;
+constexpr int PANEL_PADDING = 4;
+constexpr int PANEL_WIDTH = Hud::LINE_CHARS * CELL_WIDTH + 2 * PANEL_PADDING;
+constexpr int TEXT_HEIGHT = Hud::NUM_LINES * CELL_HEIGHT;
+constexpr int GRAPH_HEIGHT = 64;
+constexpr int GRAPH_Y = PANEL_PADDING + TEXT_HEIGHT + PANEL_PADDING;
+constexpr int PANEL_HEIGHT = GRAPH_Y + GRAPH_HEIGHT + PANEL_PADDING;
+constexpr int GRAPH_BAR_WIDTH = (PANEL_WIDTH - 2 * PANEL_PADDING) / Hud::GRAPH_SAMPLES;
+
+// The graph spans two 60 Hz frame budgets, with a marker at one budget
+constexpr float GRAPH_MAX_MS = 1000.0f / 30.0f;
+constexpr float BUDGET_MS = 1000.0f / 60.0f;
+
+constexpr std::uint32_t HUD_BACKGROUND = 0xFF202020;
+constexpr std::uint32_t HUD_TEXT = 0xFFE0E0E0;
+constexpr std::uint32_t HUD_BUDGET_LINE = 0xFF606060;
+constexpr std::uint32_t HUD_BAR_OK = COLOR_GREEN.raw;
+constexpr std::uint32_t HUD_BAR_OVER = COLOR_RED.raw;
+
+static_assert(PANEL_X + PANEL_WIDTH <= SCREEN_WIDTH, "HUD panel is wider than the screen");
+static_assert(PANEL_Y + PANEL_HEIGHT <= SCREEN_HEIGHT, "HUD panel is taller than the screen");
+static_assert(GRAPH_BAR_WIDTH >= 1, "HUD graph has more samples than pixels");
+
+Hud::Hud()
+    : panel(PANEL_WIDTH * PANEL_HEIGHT, HUD_BACKGROUND),
+      graph_background(PANEL_WIDTH * GRAPH_HEIGHT, HUD_BACKGROUND),
+      graph_next(0)
+{
+    build_atlas();
+    graph.fill(0.0f);
+
+    const int budget_y = GRAPH_HEIGHT - 1 - static_cast<int>(BUDGET_MS / GRAPH_MAX_MS * (GRAPH_HEIGHT - 1));
+    std::fill(
+        graph_background.begin() + budget_y * PANEL_WIDTH + PANEL_PADDING,
+        graph_background.begin() + (budget_y + 1) * PANEL_WIDTH - PANEL_PADDING,
+        HUD_BUDGET_LINE
+    );
+}
+
+void Hud::build_atlas()
+{
+    atlas.assign(ATLAS_WIDTH * CELL_HEIGHT, HUD_BACKGROUND);
+    glyph_index.fill(0);
+
+    for (int g = 0; g < NUM_GLYPHS; g++) {
+        glyph_index[static_cast<unsigned char>(FONT[g].c)] = g;
+        for (int fy = 0; fy < 7; fy++) {
+            for (int fx = 0; fx < 5; fx++) {
+                if (!(FONT[g].rows[fy] & (0x10 >> fx))) {
+                    continue;
+                }
+                for (int sy = 0; sy < GLYPH_SCALE; sy++) {
+                    const int row = (fy * GLYPH_SCALE + sy) * ATLAS_WIDTH;
+                    const int x = g * CELL_WIDTH + fx * GLYPH_SCALE;
+                    std::fill(atlas.begin() + row + x, atlas.begin() + row + x + GLYPH_SCALE, HUD_TEXT);
+                }
+            }
+        }
+    }
+}
+
+void Hud::set_line(const int index, const std::string& text)
+{
+    if (lines[index] == text) {
+        return;
+    }
+    lines[index] = text;
+    render_line(index);
+}
+
+void Hud::render_line(const int index)
+{
+    const std::string& text = lines[index];
+    const int top = PANEL_PADDING + index * CELL_HEIGHT;
+
+    for (int i = 0; i < LINE_CHARS; i++) {
+        int g = 0;
+        if (i < static_cast<int>(text.size())) {
+            const unsigned char c = std::toupper(static_cast<unsigned char>(text[i]));
+            g = c < glyph_index.size() ? glyph_index[c] : 0;
+        }
+        const std::uint32_t* src = atlas.data() + g * CELL_WIDTH;
+        std::uint32_t* dst = panel.data() + top * PANEL_WIDTH + PANEL_PADDING + i * CELL_WIDTH;
+        for (int y = 0; y < CELL_HEIGHT; y++) {
+            std::memcpy(dst, src, CELL_WIDTH * sizeof(std::uint32_t));
+            src += ATLAS_WIDTH;
+            dst += PANEL_WIDTH;
+        }
+    }
+}
+
+void Hud::add_frame_time(const double frame_ms)
+{
+    graph[graph_next] = static_cast<float>(frame_ms);
+    graph_next = (graph_next + 1) % GRAPH_SAMPLES;
+}
+
+void Hud::draw(std::vector<std::uint32_t>& pixels)
+{
+    // Refresh the graph area of the cached panel, oldest sample on the left
+    std::memcpy(
+        panel.data() + GRAPH_Y * PANEL_WIDTH,
+        graph_background.data(),
+        graph_background.size() * sizeof(std::uint32_t)
+    );
+    for (int i = 0; i < GRAPH_SAMPLES; i++) {
+        const float ms = graph[(graph_next + i) % GRAPH_SAMPLES];
+        const int bar_height = std::min(
+            GRAPH_HEIGHT,
+            static_cast<int>(ms / GRAPH_MAX_MS * (GRAPH_HEIGHT - 1)) + 1
+        );
+        const std::uint32_t color = ms > BUDGET_MS ? HUD_BAR_OVER : HUD_BAR_OK;
+        const int x = PANEL_PADDING + i * GRAPH_BAR_WIDTH;
+        for (int y = GRAPH_HEIGHT - bar_height; y < GRAPH_HEIGHT; y++) {
+            std::uint32_t* row = panel.data() + (GRAPH_Y + y) * PANEL_WIDTH;
+            std::fill(row + x, row + x + GRAPH_BAR_WIDTH, color);
+        }
+    }
+
+    for (int y = 0; y < PANEL_HEIGHT; y++) {
+        std::memcpy(
+            pixels.data() + (PANEL_Y + y) * SCREEN_WIDTH + PANEL_X,
+            panel.data() + y * PANEL_WIDTH,
+            PANEL_WIDTH * sizeof(std::uint32_t)
+        );
+    }
+}
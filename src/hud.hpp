@@ -0,0 +1,40 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Performance overlay drawn into the top-left corner of the framebuffer.
+// Glyphs are rasterized once into an atlas, each text line is cached as a
+// bitmap that is only redrawn when its text changes, and the whole panel
+// is copied into the framebuffer with one memcpy per row.
+class Hud {
+public:
+    static constexpr int NUM_LINES = 7;
+    static constexpr int LINE_CHARS = 40;
+    static constexpr int GRAPH_SAMPLES = 240;
+
+    Hud();
+
+    // Text is upper-cased; characters without a glyph draw as spaces.
+    void set_line(const int index, const std::string& text);
+    void add_frame_time(const double frame_ms);
+    void draw(std::vector<std::uint32_t>& pixels);
+
+private:
+    std::vector<std::uint32_t> atlas;
+    std::array<int, 128> glyph_index;
+    std::array<std::string, NUM_LINES> lines;
+    std::vector<std::uint32_t> panel;
+    std::vector<std::uint32_t> graph_background;
+    std::array<float, GRAPH_SAMPLES> graph;
+    std::size_t graph_next;
+
+    void build_atlas();
+    void render_line(const int index);
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "layers.hpp"
+#include "constants.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void LayerCache::add_layer(const std::string& name, DrawFunc draw, const bool opaque)
+{
+    layers.push_back({name, std::move(draw), opaque, true, std::vector<std::uint32_t>(NUM_PIXELS, COLOR_BLANK.raw)});
+    flattened_valid = false;
+}
+
+void LayerCache::invalidate(const std::string& name)
+{
+    find(name).dirty = true;
+}
+
+LayerCache::Layer& LayerCache::find(const std::string& name)
+{
+    for (Layer& layer : layers) {
+        if (layer.name == name) {
+            return layer;
+        }
+    }
+    throw std::runtime_error("LayerCache: no layer named " + name);
+}
+
+void LayerCache::composite(std::vector<std::uint32_t>& target)
+{
+    for (Layer& layer : layers) {
+        if (!layer.dirty) {
+            continue;
+        }
+        std::fill(layer.pixels.begin(), layer.pixels.end(), COLOR_BLANK.raw);
+        layer.draw(layer.pixels);
+        layer.dirty = false;
+        flattened_valid = false;
+        redraw_count++;
+    }
+
+    if (!flattened_valid) {
+        flattened.assign(NUM_PIXELS, COLOR_BLANK.raw);
+        for (const Layer& layer : layers) {
+            if (layer.opaque) {
+                std::memcpy(flattened.data(), layer.pixels.data(), NUM_PIXELS * sizeof(std::uint32_t));
+            } else {
+                blend_over(flattened.data(), layer.pixels.data(), NUM_PIXELS);
+            }
+        }
+        flattened_valid = true;
+        flatten_count++;
+    }
+
+    target.resize(NUM_PIXELS);
+    std::memcpy(target.data(), flattened.data(), NUM_PIXELS * sizeof(std::uint32_t));
+}
+
+std::size_t LayerCache::layers_redrawn() const
+{
+    return redraw_count;
+}
+
+std::size_t LayerCache::flattens() const
+{
+    return flatten_count;
+}
+
+static std::uint32_t blend_pixel(const std::uint32_t dst, const std::uint32_t src)
+{
+    const std::uint32_t a = src >> 24;
+    const std::uint32_t inv_a = 255 - a;
+    const std::uint32_t r = (((src >> 16) & 0xFF) * a + ((dst >> 16) & 0xFF) * inv_a + 127) / 255;
+    const std::uint32_t g = (((src >> 8) & 0xFF) * a + ((dst >> 8) & 0xFF) * inv_a + 127) / 255;
+    const std::uint32_t b = ((src & 0xFF) * a + (dst & 0xFF) * inv_a + 127) / 255;
+    const std::uint32_t out_a = a + ((dst >> 24) * inv_a + 127) / 255;
+    return (out_a << 24) | (r << 16) | (g << 8) | b;
+}
+
+#if defined(__SSE2__)
+// blend_pixel() for two pixels widened to 16-bit lanes. The source
+// factor of the alpha lane is 255 rather than a, so the same formula
+// gives out_a = a + dst_a * inv_a / 255. Every sum fits in 16 bits, and
+// x / 255 == (x * 0x8081) >> 23 for all of them.
+static __m128i blend_pixels16(const __m128i dst, const __m128i src)
+{
+    const __m128i alpha_lanes = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    const __m128i color_lanes = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i max = _mm_set1_epi16(255);
+    const __m128i bias = _mm_set1_epi16(127);
+    const __m128i div255 = _mm_set1_epi16(static_cast<short>(0x8081));
+    // Broadcast each pixel's alpha to its four lanes
+    const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i src_factor = _mm_or_si128(_mm_and_si128(a, color_lanes), alpha_lanes);
+    const __m128i inv_a = _mm_sub_epi16(max, a);
+    const __m128i sum = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(src, src_factor), _mm_mullo_epi16(dst, inv_a)),
+        bias
+    );
+    return _mm_srli_epi16(_mm_mulhi_epu16(sum, div255), 7);
+}
+#endif
+
+// Most layer pixels are either fully covered or empty, so blocks of
+// four pixels that are all one or the other are copied or skipped
+// without doing any blending arithmetic. Other blocks are blended four
+// pixels at a time.
+void blend_over(std::uint32_t* dst, const std::uint32_t* src, const std::size_t count)
+{
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i alpha = _mm_and_si128(s, alpha_mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero)) == 0xFFFF) {
+            continue;
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask)) == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+            continue;
+        }
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i lo = blend_pixels16(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+        const __m128i hi = blend_pixels16(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        const std::uint32_t a = src[i] >> 24;
+        if (a == 0xFF) {
+            dst[i] = src[i];
+        } else if (a != 0) {
+            dst[i] = blend_pixel(dst[i], src[i]);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef LAYERS_H
+#define LAYERS_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Named full-screen layers of retained content. Each layer keeps its own
+// ARGB8888 pixels, where alpha is coverage; pixels a layer doesn't draw stay
+// COLOR_BLANK (alpha 0). A layer is only re-rasterized after invalidate(),
+// and the flattened result of all layers is only rebuilt when some layer
+// changed, so a frame with static layers costs a single copy.
+class LayerCache {
+public:
+    using DrawFunc = std::function<void(std::vector<std::uint32_t>&)>;
+
+    // Layers are composited in the order they are added, first at the bottom.
+    // An opaque layer covers the whole screen, so it is copied instead of blended.
+    void add_layer(const std::string& name, DrawFunc draw, const bool opaque = false);
+    void invalidate(const std::string& name);
+
+    // Overwrites target with all layers composited over COLOR_BLANK
+    void composite(std::vector<std::uint32_t>& target);
+
+    std::size_t layers_redrawn() const;
+    std::size_t flattens() const;
+
+private:
+    struct Layer {
+        std::string name;
+        DrawFunc draw;
+        bool opaque;
+        bool dirty;
+        std::vector<std::uint32_t> pixels;
+    };
+
+    std::vector<Layer> layers;
+    std::vector<std::uint32_t> flattened;
+    bool flattened_valid = false;
+    std::size_t redraw_count = 0;
+    std::size_t flatten_count = 0;
+
+    Layer& find(const std::string& name);
+};
+
+// Composites src over dst using src's alpha
+void blend_over(std::uint32_t* dst, const std::uint32_t* src, const std::size_t count);
+
+#endif
@@ -0,0 +1,142 @@
+#include "lighting.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// Lights one vertex; used for the tail of a batch
+static float light_vertex(const Point3D& p, const Vec3& n, const std::vector<Light>& lights)
+{
+    float h = 0.0f;
+    for (const Light& light : lights) {
+        if (light.type == LightType::ambient) {
+            h += light.intensity;
+            continue;
+        }
+
+        float lx = light.x;
+        float ly = light.y;
+        float lz = light.z;
+        if (light.type == LightType::point) {
+            lx -= p.x;
+            ly -= p.y;
+            lz -= p.z;
+        }
+        const float n_dot_l = n.x * lx + n.y * ly + n.z * lz;
+        if (n_dot_l > 0.0f) {
+            h += light.intensity * n_dot_l / std::sqrt(lx * lx + ly * ly + lz * lz);
+        }
+    }
+    return std::clamp(h, 0.0f, 1.0f);
+}
+
+void light_vertices(
+    Point3D* vertices,
+    const Vec3* normals,
+    const std::size_t count,
+    const std::vector<Light>& lights
+) {
+    std::size_t i = 0;
+#if defined(__SSE__)
+    // Four vertices per iteration. Positions and normals are transposed
+    // into x, y and z registers so that each light is applied to all
+    // four vertices with the same instructions.
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        const Point3D* p = vertices + i;
+        const Vec3* n = normals + i;
+        const __m128 px = _mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x);
+        const __m128 py = _mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y);
+        const __m128 pz = _mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z);
+        const __m128 nx = _mm_setr_ps(n[0].x, n[1].x, n[2].x, n[3].x);
+        const __m128 ny = _mm_setr_ps(n[0].y, n[1].y, n[2].y, n[3].y);
+        const __m128 nz = _mm_setr_ps(n[0].z, n[1].z, n[2].z, n[3].z);
+
+        __m128 h = zero;
+        for (const Light& light : lights) {
+            const __m128 intensity = _mm_set1_ps(light.intensity);
+            if (light.type == LightType::ambient) {
+                h = _mm_add_ps(h, intensity);
+                continue;
+            }
+
+            __m128 lx = _mm_set1_ps(light.x);
+            __m128 ly = _mm_set1_ps(light.y);
+            __m128 lz = _mm_set1_ps(light.z);
+            if (light.type == LightType::point) {
+                lx = _mm_sub_ps(lx, px);
+                ly = _mm_sub_ps(ly, py);
+                lz = _mm_sub_ps(lz, pz);
+            }
+            const __m128 n_dot_l = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(nx, lx), _mm_mul_ps(ny, ly)),
+                _mm_mul_ps(nz, lz)
+            );
+            const __m128 l_len = _mm_sqrt_ps(_mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(lx, lx), _mm_mul_ps(ly, ly)),
+                _mm_mul_ps(lz, lz)
+            ));
+            // Lights behind the surface contribute nothing
+            const __m128 facing = _mm_cmpgt_ps(n_dot_l, zero);
+            const __m128 diffuse = _mm_div_ps(_mm_mul_ps(intensity, n_dot_l), l_len);
+            h = _mm_add_ps(h, _mm_and_ps(facing, diffuse));
+        }
+        h = _mm_max_ps(_mm_min_ps(h, one), zero);
+
+        alignas(16) float out[4];
+        _mm_store_ps(out, h);
+        for (int j = 0; j < 4; j++) {
+            vertices[i + j].h = out[j];
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        vertices[i].h = light_vertex(vertices[i], normals[i], lights);
+    }
+}
+
+LightingCache::LightingCache()
+    : lights_version(1), lit_count(0)
+{
+}
+
+LightingCache::MeshId LightingCache::add_mesh(const std::vector<Point3D>& vertices, const std::vector<Vec3>& normals)
+{
+    assert(vertices.size() == normals.size());
+    meshes.push_back({vertices, normals, 0});
+    return meshes.size() - 1;
+}
+
+void LightingCache::update_mesh(const MeshId id, const std::vector<Point3D>& vertices, const std::vector<Vec3>& normals)
+{
+    assert(vertices.size() == normals.size());
+    meshes[id].vertices = vertices;
+    meshes[id].normals = normals;
+    meshes[id].lit_version = 0;
+}
+
+void LightingCache::set_lights(const std::vector<Light>& new_lights)
+{
+    lights = new_lights;
+    lights_version++;
+}
+
+const std::vector<Point3D>& LightingCache::lit_vertices(const MeshId id)
+{
+    Mesh& mesh = meshes[id];
+    if (mesh.lit_version != lights_version) {
+        light_vertices(mesh.vertices.data(), mesh.normals.data(), mesh.vertices.size(), lights);
+        mesh.lit_version = lights_version;
+        lit_count += mesh.vertices.size();
+    }
+    return mesh.vertices;
+}
+
+std::size_t LightingCache::vertices_lit() const
+{
+    return lit_count;
+}
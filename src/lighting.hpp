@@ -0,0 +1,73 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include "point.hpp"
+#include <vector>
+#include <cstddef>
+
+struct Vec3 {
+    float x;
+    float y;
+    float z;
+};
+
+enum class LightType {
+    ambient,
+    directional,
+    point
+};
+
+// For directional lights, (x, y, z) is the direction towards the light.
+// For point lights, it is the light's position. Ambient lights ignore it.
+struct Light {
+    LightType type;
+    float intensity;
+    float x;
+    float y;
+    float z;
+};
+
+// Diffuse lighting as in Computer Graphics from Scratch: each vertex's h is
+// the sum of the ambient intensities plus intensity * cos(angle between the
+// normal and the direction to the light) for each light in front of it,
+// clamped to [0, 1]. Normals must be unit length.
+void light_vertices(
+    Point3D* vertices,
+    const Vec3* normals,
+    const std::size_t count,
+    const std::vector<Light>& lights
+);
+
+// Keeps lit copies of meshes so that lighting is only recomputed
+// when a mesh or the set of lights changes.
+class LightingCache {
+public:
+    using MeshId = std::size_t;
+
+    LightingCache();
+
+    MeshId add_mesh(const std::vector<Point3D>& vertices, const std::vector<Vec3>& normals);
+    void update_mesh(const MeshId id, const std::vector<Point3D>& vertices, const std::vector<Vec3>& normals);
+    void set_lights(const std::vector<Light>& lights);
+
+    // Returns the mesh's vertices with h filled in by light_vertices()
+    const std::vector<Point3D>& lit_vertices(const MeshId id);
+
+    // Number of vertices lit since construction, for profiling
+    std::size_t vertices_lit() const;
+
+private:
+    struct Mesh {
+        std::vector<Point3D> vertices;
+        std::vector<Vec3> normals;
+        // lights_version the vertices were last lit with; 0 means never
+        unsigned int lit_version;
+    };
+
+    std::vector<Mesh> meshes;
+    std::vector<Light> lights;
+    unsigned int lights_version;
+    std::size_t lit_count;
+};
+
+#endif
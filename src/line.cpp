@@ -150,25 +150,3 @@ inline void draw_vertical_run(
     }
     x += sx;
 }
-
-void inc_bresenham_gentle(int& x, int& y, int& step, int& p, int& e_same, int& e_diff)
-{
-    x += step;
-    if (p < 0) {
-        p += e_same;
-    } else {
-        y++;
-        p += e_diff;
-    }
-}
-
-void inc_bresenham_steep(int& x, int& y, int& step, int& p, int& e_same, int& e_diff)
-{
-    y++;
-    if (p < 0) {
-        p += e_same;
-    } else {
-        x += step;
-        p += e_diff;
-    }
-}
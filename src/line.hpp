@@ -13,7 +13,67 @@ void draw_line_bresenham(
     int by
 );
 
-void inc_bresenham_gentle(int& x, int& y, int& step, int& p, int& e_same, int& e_diff);
-void inc_bresenham_steep(int& x, int& y, int& step, int& p, int& e_same, int& e_diff);
+// Bresenham edge walkers for scanline filling.
+// Both advance one scanline per call to next_row(), so a filler
+// templated on the edge types can inline the stepping in each case.
+
+// Gentle slope (dx > dy): x is stepped until y changes
+struct BresenhamGentleEdge {
+    int x;
+    int step;
+    int p;
+    int e_same;
+    int e_diff;
+
+    BresenhamGentleEdge(const int x_start, const int x_end, const int dx, const int dy)
+        : x(x_start),
+          step(x_start < x_end ? 1 : -1),
+          p(2 * dy - dx),
+          e_same(2 * dy),
+          e_diff(2 * (dy - dx))
+    {
+    }
+
+    void next_row()
+    {
+        for (;;) {
+            x += step;
+            if (p < 0) {
+                p += e_same;
+            } else {
+                p += e_diff;
+                return;
+            }
+        }
+    }
+};
+
+// Steep slope (dy >= dx): y always changes, x only sometimes
+struct BresenhamSteepEdge {
+    int x;
+    int step;
+    int p;
+    int e_same;
+    int e_diff;
+
+    BresenhamSteepEdge(const int x_start, const int x_end, const int dx, const int dy)
+        : x(x_start),
+          step(x_start < x_end ? 1 : -1),
+          p(2 * dx - dy),
+          e_same(2 * dx),
+          e_diff(2 * (dx - dy))
+    {
+    }
+
+    void next_row()
+    {
+        if (p < 0) {
+            p += e_same;
+        } else {
+            x += step;
+            p += e_diff;
+        }
+    }
+};
 
 #endif
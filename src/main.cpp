@@ -1,12 +1,33 @@
 #include <iostream>
 #include <chrono>
+#include <algorithm>
 #include <cstddef>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iterator>
 #include "constants.hpp"
 #include "utils.hpp"
 #include "point.hpp"
 #include "line.hpp"
 #include "triangle.hpp"
 #include "graphics.hpp"
+#include "spanbuffer.hpp"
+#include "framebuffer.hpp"
+#include "frameloop.hpp"
+#include "scenegraph.hpp"
+#include "hud.hpp"
+#include "framesink.hpp"
+#include "lighting.hpp"
+#include "layers.hpp"
+#include "resolution.hpp"
+#include "sharedframes.hpp"
+#include "perfcounters.hpp"
+#include "overdraw.hpp"
 #include <SDL2/SDL.h>
 
 struct Square {
@@ -16,13 +37,57 @@ struct Square {
     Point3D d;
 };
 
-void render_shapes();
+// Options for the real-time loop, set from the command line
+struct LoopOptions {
+    const char* stream_path = nullptr;
+    const char* shm_name = nullptr;
+    bool shm_replace = false;
+    double dynres_budget_ms = 0.0;
+    bool perf = false;
+};
+
+void render_shapes(const LoopOptions& options);
 bool wait_for_input();
+std::size_t count_visibility_errors(const VisibilityBuffer& vis, const std::vector<Triangle3D>& tris);
+StreamFormat stream_format_for(const std::string& path);
 
-int main()
+// Usage: ./rasterizer [--stream out.y4m|out.yuv|out.argb|-] [--shm NAME [--shm-replace]] [--dynres BUDGET_MS] [--perf]
+// With --stream, every frame of the real-time loop is also written
+// to the given file, or to stdout as Y4M if the path is "-".
+// With --shm, every frame is also published to the POSIX shared-memory
+// segment NAME (e.g. /rasterizer), for ./shmreader and similar readers.
+// It refuses to start if NAME already exists, unless --shm-replace is
+// given to remove a segment left behind by an earlier run.
+// With --dynres, the real-time loop lowers its render resolution
+// whenever a frame takes more than BUDGET_MS to draw.
+// With --perf, each stage of the real-time loop is measured with
+// hardware performance counters, and a report is printed at the end.
+int main(int argc, char* argv[])
 {
+    LoopOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+            options.stream_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            options.shm_name = argv[++i];
+        } else if (std::strcmp(argv[i], "--shm-replace") == 0) {
+            options.shm_replace = true;
+        } else if (std::strcmp(argv[i], "--dynres") == 0 && i + 1 < argc && std::atof(argv[i + 1]) > 0.0) {
+            options.dynres_budget_ms = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--perf") == 0) {
+            options.perf = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--stream out.y4m|out.yuv|out.argb|-] [--shm NAME [--shm-replace]] [--dynres BUDGET_MS] [--perf]" << std::endl;
+            return 1;
+        }
+    }
+    if (options.stream_path != nullptr && std::strcmp(options.stream_path, "-") == 0) {
+        // Keep log output out of the video stream
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
     try {
-        render_shapes();
+        render_shapes(options);
     } catch (std::runtime_error& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
@@ -30,7 +95,22 @@ int main()
     return 0;
 }
 
-void render_shapes()
+StreamFormat stream_format_for(const std::string& path)
+{
+    auto ends_with = [&](const std::string& suffix) {
+        return path.size() >= suffix.size()
+            && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (ends_with(".yuv")) {
+        return StreamFormat::yuv420;
+    }
+    if (ends_with(".argb") || ends_with(".raw")) {
+        return StreamFormat::argb;
+    }
+    return StreamFormat::y4m;
+}
+
+void render_shapes(const LoopOptions& options)
 {
     Graphics gfx;
 
@@ -119,6 +199,35 @@ void render_shapes()
         return;
     }
 
+    // LIT TRIANGLE
+    // Same triangle, but h comes from the lighting stage instead of literals.
+    // The normals lean outwards as if the triangle were part of a dome
+    // facing the camera, which looks along +z.
+    const std::vector<Vec3> greenTri_normals = {
+        {-0.40f, -0.50f, -0.77f},
+        { 0.40f,  0.10f, -0.91f},
+        { 0.05f,  0.50f, -0.86f}
+    };
+    const std::vector<Light> lights = {
+        {LightType::ambient, 0.2f, 0.0f, 0.0f, 0.0f},
+        {LightType::directional, 0.2f, 1.0f, 4.0f, -4.0f},
+        {LightType::point, 0.6f, -300.0f, 300.0f, -400.0f}
+    };
+    LightingCache lighting;
+    lighting.set_lights(lights);
+    const LightingCache::MeshId greenTri_mesh = lighting.add_mesh({greenTri.a, greenTri.b, greenTri.c}, greenTri_normals);
+    start_time = std::chrono::system_clock::now();
+    const std::vector<Point3D>& lit = lighting.lit_vertices(greenTri_mesh);
+    end_time = std::chrono::system_clock::now();
+    const auto light_us_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    std::cout << "Lighting: " << light_us_elapsed.count() << " us (h = "
+              << lit[0].h << ", " << lit[1].h << ", " << lit[2].h << ")" << std::endl;
+    draw_shaded_triangle(gfx.pixels, SCREEN_WIDTH, COLOR_GREEN.raw, lit[0], lit[1], lit[2]);
+    gfx.render();
+    if (wait_for_input()) {
+        return;
+    }
+
     // FILLED TRIANGLE (BRESENHAM)
     start_time = std::chrono::system_clock::now();
     draw_filled_triangle_3d(gfx.pixels, SCREEN_WIDTH, COLOR_GREEN.raw, greenTri.a, greenTri.b, greenTri.c);
@@ -130,6 +239,149 @@ void render_shapes()
         return;
     }
 
+    // OVERLAPPING TRIANGLES (SPAN BUFFER)
+    // Nearer triangles are submitted last to show that
+    // hidden spans are clipped away before any pixel is written.
+    static constexpr Triangle3D overlapTris[] = {
+        {{-400, -300, 3, 0}, { 100,  300, 3, 0}, { 300, -200, 3, 0}},
+        {{-300,  250, 2, 0}, { 350,  200, 2, 0}, {   0, -350, 2, 0}},
+        {{-150, -100, 1, 0}, { 150, -100, 1, 0}, {   0,  150, 1, 0}}
+    };
+    static constexpr std::uint32_t overlapColors[] = {
+        COLOR_RED.raw,
+        COLOR_GREEN.raw,
+        COLOR_BLUE.raw
+    };
+    SpanBuffer spans(SCREEN_WIDTH, SCREEN_HEIGHT);
+    start_time = std::chrono::system_clock::now();
+    for (std::size_t i = 0; i < std::size(overlapTris); i++) {
+        const Triangle3D& t = overlapTris[i];
+        draw_filled_triangle_3d_spans(spans, overlapColors[i], t.a, t.b, t.c);
+    }
+    spans.resolve(gfx.pixels);
+    end_time = std::chrono::system_clock::now();
+    const auto span_us_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    std::cout << "Overlapping triangles (span buffer): " << span_us_elapsed.count() << " us, "
+              << spans.span_count() << " spans" << std::endl;
+    gfx.render();
+    if (wait_for_input()) {
+        return;
+    }
+
+    // OVERLAPPING TRIANGLES (LOW-COLOR FORMATS)
+    // Resolve the same spans into 16-bit and 8-bit framebuffers
+    start_time = std::chrono::system_clock::now();
+    Framebuffer<FormatRGB565> fb565(SCREEN_WIDTH, SCREEN_HEIGHT);
+    fb565.clear(COLOR_BLANK.raw);
+    spans.resolve(fb565);
+    end_time = std::chrono::system_clock::now();
+    const auto rgb565_us_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    std::cout << "Overlapping triangles (RGB565): " << rgb565_us_elapsed.count() << " us" << std::endl;
+    start_time = std::chrono::system_clock::now();
+    Framebuffer<FormatRGB332> fb332(SCREEN_WIDTH, SCREEN_HEIGHT);
+    fb332.clear(COLOR_BLANK.raw);
+    spans.resolve(fb332);
+    end_time = std::chrono::system_clock::now();
+    const auto rgb332_us_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    std::cout << "Overlapping triangles (RGB332): " << rgb332_us_elapsed.count() << " us" << std::endl;
+    gfx.render_framebuffer(fb332);
+    if (wait_for_input()) {
+        return;
+    }
+
+    // OVERDRAW HEATMAP
+    // Draw the same triangles directly, nearest last, counting every
+    // pixel write, then show how often each pixel was written and
+    // which tiles the drawing time went to.
+    OverdrawMap overdraw(SCREEN_WIDTH, SCREEN_HEIGHT);
+    for (std::size_t i = 0; i < std::size(overlapTris); i++) {
+        const Triangle3D& t = overlapTris[i];
+        start_time = std::chrono::system_clock::now();
+        draw_filled_triangle_3d(gfx.pixels, SCREEN_WIDTH, overlapColors[i], t.a, t.b, t.c);
+        end_time = std::chrono::system_clock::now();
+        draw_filled_triangle_overdraw(overdraw, project_special(t.a), project_special(t.b), project_special(t.c));
+        overdraw.add_cost(std::chrono::duration<double, std::micro>(end_time - start_time).count());
+    }
+    const OverdrawStats overdraw_stats = overdraw.stats(3);
+    std::cout << "Overdraw: " << overdraw_stats.writes << " writes to " << overdraw_stats.covered
+              << " pixels, average " << overdraw_stats.average << ", max " << overdraw_stats.max
+              << " (span buffer: " << spans.span_count() << " spans, 1 write per pixel)" << std::endl;
+    for (const OverdrawTile& tile : overdraw_stats.hottest) {
+        std::cout << "  tile (" << tile.x << ", " << tile.y << "): " << tile.writes << " writes, "
+                  << tile.cost << " us" << std::endl;
+    }
+    overdraw.draw_heatmap(gfx.pixels);
+    gfx.render();
+    if (wait_for_input()) {
+        return;
+    }
+    overdraw.draw_cost_heatmap(gfx.pixels);
+    gfx.render();
+    if (wait_for_input()) {
+        return;
+    }
+
+    // SHADED OVERLAPPING TRIANGLES (VISIBILITY BUFFER)
+    // Shading every triangle directly, farthest first, shades the
+    // hidden pixels too. The visibility buffer only records the nearest
+    // triangle per pixel, then shades each visible pixel once.
+    const std::vector<Triangle3D> shadedOverlapTris = {
+        {{-400, -300, 3, 1.0}, { 100,  300, 3, 0.2}, { 300, -200, 3, 0.6}},
+        {{-300,  250, 2, 0.3}, { 350,  200, 2, 1.0}, {   0, -350, 2, 0.5}},
+        {{-150, -100, 1, 1.0}, { 150, -100, 1, 1.0}, {   0,  150, 1, 0.1}}
+    };
+    const std::vector<std::uint32_t> shadedOverlapColors(std::begin(overlapColors), std::end(overlapColors));
+    start_time = std::chrono::system_clock::now();
+    for (std::size_t i = 0; i < shadedOverlapTris.size(); i++) {
+        const Triangle3D& t = shadedOverlapTris[i];
+        draw_shaded_triangle(gfx.pixels, SCREEN_WIDTH, shadedOverlapColors[i], t.a, t.b, t.c);
+    }
+    end_time = std::chrono::system_clock::now();
+    const auto direct_shade_us_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    std::fill(gfx.pixels.begin(), gfx.pixels.end(), COLOR_BLANK.raw);
+    VisibilityBuffer vis(SCREEN_WIDTH, SCREEN_HEIGHT);
+    start_time = std::chrono::system_clock::now();
+    for (std::size_t i = 0; i < shadedOverlapTris.size(); i++) {
+        const Triangle3D& t = shadedOverlapTris[i];
+        draw_triangle_visibility(vis, static_cast<std::uint32_t>(i), t.a, t.b, t.c);
+    }
+    const std::size_t shaded_pixels = shade_visibility_buffer(gfx.pixels, SCREEN_WIDTH, vis, shadedOverlapTris, shadedOverlapColors);
+    end_time = std::chrono::system_clock::now();
+    const auto vis_us_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+    std::cout << "Shaded overlapping triangles: " << direct_shade_us_elapsed.count() << " us direct, "
+              << vis_us_elapsed.count() << " us with a visibility buffer (" << shaded_pixels
+              << " pixels shaded once)" << std::endl;
+    gfx.render();
+    if (wait_for_input()) {
+        return;
+    }
+
+    // INTERSECTING SLANTED TRIANGLES (VISIBILITY BUFFER)
+    // Each triangle is in front along part of the line where they cross,
+    // so the buffer must pick the nearer one per pixel
+    const std::vector<Triangle3D> slantedTris = {
+        {{-350, -250, 1.0, 1.0}, { 350, -200, 4.0, 0.4}, {   0,  300, 2.5, 0.7}},
+        {{-300,  250, 4.0, 0.4}, { 300,  280, 1.0, 1.0}, {  50, -300, 2.0, 0.7}}
+    };
+    const std::vector<std::uint32_t> slantedColors = {COLOR_RED.raw, COLOR_BLUE.raw};
+    std::fill(gfx.pixels.begin(), gfx.pixels.end(), COLOR_BLANK.raw);
+    vis.clear();
+    for (std::size_t i = 0; i < slantedTris.size(); i++) {
+        const Triangle3D& t = slantedTris[i];
+        draw_triangle_visibility(vis, static_cast<std::uint32_t>(i), t.a, t.b, t.c);
+    }
+    const std::size_t slanted_pixels = shade_visibility_buffer(gfx.pixels, SCREEN_WIDTH, vis, slantedTris, slantedColors);
+    const std::size_t slanted_errors = count_visibility_errors(vis, slantedTris);
+    std::cout << "Intersecting slanted triangles: " << slanted_errors << " of " << slanted_pixels
+              << " pixels differ from a per-pixel depth test" << std::endl;
+    if (slanted_errors > 0) {
+        std::cerr << __func__ << ": ERROR: visibility buffer picked the farther triangle\n";
+    }
+    gfx.render();
+    if (wait_for_input()) {
+        return;
+    }
+
     // TINY TRIANGLE
     static constexpr Triangle2D tinyTri = {
         {10, 10},
@@ -157,7 +409,316 @@ void render_shapes()
     const auto ttus_us_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
     std::cout << "Tiny triangle upscaled: " << ttus_us_elapsed.count() << " us" << std::endl;
     gfx.render();
-    wait_for_input();
+    if (wait_for_input()) {
+        return;
+    }
+
+    // REAL-TIME LOOP
+    // Spin the green triangle about the screen center and a second cube
+    // about its own center until Escape is pressed. The original cube is
+    // static, so the scene graph never recomputes its projection and its
+    // layer is only rasterized once.
+    static constexpr float spin_radians_per_second = 1.0f;
+    float angle = 0.0f;
+    float prev_angle = 0.0f;
+    const std::vector<Point3D> cube_verts = {
+        cube_front_verts.a, cube_front_verts.b, cube_front_verts.c, cube_front_verts.d,
+        cube_back_verts.a, cube_back_verts.b, cube_back_verts.c, cube_back_verts.d
+    };
+    static constexpr int cube_edges[12][2] = {
+        {0, 1}, {1, 2}, {2, 3}, {3, 0},
+        {4, 5}, {5, 6}, {6, 7}, {7, 4},
+        {0, 4}, {1, 5}, {2, 6}, {3, 7}
+    };
+    SceneGraph scene;
+    const SceneGraph::NodeId static_cube = scene.add_node();
+    scene.set_vertices(static_cube, cube_verts);
+    // The child node moves the cube's center (-1.5, 0, 5.5) to the origin,
+    // so rotating the pivot spins the cube in place to the right of the static one.
+    const SceneGraph::NodeId spin_pivot = scene.add_node();
+    scene.set_local_transform(spin_pivot, translation_matrix(1.0f, 0.0f, 5.5f));
+    const SceneGraph::NodeId spin_cube = scene.add_node(spin_pivot);
+    scene.set_local_transform(spin_cube, translation_matrix(1.5f, 0.0f, -5.5f));
+    scene.set_vertices(spin_cube, cube_verts);
+    std::size_t nodes_updated = 0;
+
+    // With dynamic resolution, the scene is drawn into the top-left
+    // render_scale-sized corner of the framebuffer and then stretched
+    // over the whole screen. Screen points are scaled down to match.
+    ResolutionScalerConfig dynres_config;
+    dynres_config.budget_ms = options.dynres_budget_ms;
+    ResolutionScaler dynres(dynres_config);
+    const bool use_dynres = options.dynres_budget_ms > 0.0;
+    std::vector<std::uint32_t> scaled_frame;
+    double resize_ms = 0.0;
+    auto to_render = [&](const SDL_Point& p) -> SDL_Point {
+        if (!use_dynres) {
+            return p;
+        }
+        const double s = dynres.scale();
+        return {static_cast<int>(std::lround(p.x * s)), static_cast<int>(std::lround(p.y * s))};
+    };
+
+    auto draw_cube = [&](std::vector<std::uint32_t>& pixels, const SceneGraph::NodeId cube) {
+        const std::vector<SDL_Point>& v = scene.projected_vertices(cube);
+        for (const auto& edge : cube_edges) {
+            const SDL_Point p0 = to_render(v[edge[0]]);
+            const SDL_Point p1 = to_render(v[edge[1]]);
+            draw_line_bresenham(pixels, COLOR_BLUE.raw, p0.x, p0.y, p1.x, p1.y);
+        }
+    };
+    LayerCache layers;
+    layers.add_layer("static cube", [&](std::vector<std::uint32_t>& pixels) {
+        draw_cube(pixels, static_cube);
+    });
+
+    // Press H to toggle the performance overlay.
+    // Its text is refreshed a few times per second so it stays readable.
+    Hud hud;
+    bool show_hud = true;
+    double hud_refresh_ms = 0.0;
+    double raster_ms = 0.0;
+    double scene_ms = 0.0;
+    double hud_ms = 0.0;
+    double present_ms = 0.0;
+    int frame_pixels = 0;
+    auto ms_since = [](const std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    FrameLoopConfig loop_config;
+    loop_config.target_fps = 60.0;
+    FrameStats stats;
+    std::unique_ptr<FrameSink> sink;
+    if (options.stream_path != nullptr) {
+        sink = std::make_unique<FrameSink>(
+            options.stream_path,
+            stream_format_for(options.stream_path),
+            SCREEN_WIDTH,
+            SCREEN_HEIGHT,
+            static_cast<int>(loop_config.target_fps)
+        );
+    }
+    std::unique_ptr<SharedFrameWriter> shared_frames;
+    if (options.shm_name != nullptr) {
+        shared_frames = std::make_unique<SharedFrameWriter>(
+            options.shm_name, SCREEN_WIDTH, SCREEN_HEIGHT, 3, options.shm_replace
+        );
+    }
+    std::unique_ptr<StageProfiler> profiler;
+    if (options.perf) {
+        profiler = std::make_unique<StageProfiler>();
+    }
+    auto begin_stage = [&]() {
+        if (profiler) {
+            profiler->begin();
+        }
+        return std::chrono::steady_clock::now();
+    };
+    auto end_stage = [&](const char* stage, const std::chrono::steady_clock::time_point start, const std::uint64_t pixels) {
+        if (profiler) {
+            profiler->end(stage, pixels);
+        }
+        return ms_since(start);
+    };
+    auto update = [&](const double dt) {
+        prev_angle = angle;
+        angle += spin_radians_per_second * static_cast<float>(dt);
+        scene.set_local_transform(spin_pivot, translation_matrix(1.0f, 0.0f, 5.5f) * rotation_y_matrix(angle));
+    };
+    auto render = [&](const double alpha) {
+        auto stage_start = begin_stage();
+        nodes_updated += scene.update();
+        scene_ms = end_stage("scene update", stage_start, 0);
+
+        const float a = prev_angle + (angle - prev_angle) * static_cast<float>(alpha);
+        const float cos_a = std::cos(a);
+        const float sin_a = std::sin(a);
+        auto rotate = [&](const Point3D& p) -> Point3D {
+            return {p.x * cos_a - p.y * sin_a, p.x * sin_a + p.y * cos_a, p.z, p.h};
+        };
+        const SDL_Point va = to_render(project_special(rotate(greenTri.a)));
+        const SDL_Point vb = to_render(project_special(rotate(greenTri.b)));
+        const SDL_Point vc = to_render(project_special(rotate(greenTri.c)));
+        // Counting walks the triangle a second time, so it is kept out
+        // of the timed stage and skipped when nothing displays it
+        if (show_hud || profiler) {
+            frame_pixels = count_filled_triangle_pixels(va, vb, vc);
+        }
+
+        // The layers overwrite the whole frame, so the
+        // framebuffer doesn't need clearing between frames.
+        stage_start = begin_stage();
+        layers.composite(gfx.pixels);
+        raster_ms = end_stage("layers", stage_start, NUM_PIXELS);
+        stage_start = begin_stage();
+        draw_filled_triangle_bres(gfx.pixels, SCREEN_WIDTH, COLOR_GREEN.raw, va, vb, vc);
+        draw_cube(gfx.pixels, spin_cube);
+        raster_ms += end_stage("raster", stage_start, frame_pixels);
+
+        if (use_dynres) {
+            stage_start = begin_stage();
+            if (dynres.scale() < 1.0) {
+                resize_bilinear(gfx.pixels, dynres.width(), dynres.height(), scaled_frame);
+                gfx.pixels.swap(scaled_frame);
+            }
+            resize_ms = end_stage("resize", stage_start, NUM_PIXELS);
+            if (dynres.add_frame(scene_ms + raster_ms + resize_ms)) {
+                layers.invalidate("static cube");
+            }
+        }
+
+        if (show_hud) {
+            stage_start = begin_stage();
+            hud.add_frame_time(stats.last());
+            hud_refresh_ms += stats.last();
+            if (hud_refresh_ms >= 250.0) {
+                hud_refresh_ms = 0.0;
+                char text[Hud::LINE_CHARS + 1];
+                std::snprintf(text, sizeof(text), "FRAME %6.2f MS  %5.1f FPS", stats.mean(), 1000.0 / stats.mean());
+                hud.set_line(0, text);
+                std::snprintf(text, sizeof(text), "P95 %.2f  P99 %.2f  MAX %.2f",
+                    stats.percentile(0.95), stats.percentile(0.99), stats.worst());
+                hud.set_line(1, text);
+                std::snprintf(text, sizeof(text), "SCENE %.3f  RASTER %.3f  RESIZE %.3f", scene_ms, raster_ms, resize_ms);
+                hud.set_line(2, text);
+                std::snprintf(text, sizeof(text), "HUD %.3f  PRESENT %.3f MS", hud_ms, present_ms);
+                hud.set_line(3, text);
+                std::snprintf(text, sizeof(text), "TRIS 1  PIXELS %d  RES %dX%d", frame_pixels,
+                    use_dynres ? dynres.width() : SCREEN_WIDTH, use_dynres ? dynres.height() : SCREEN_HEIGHT);
+                hud.set_line(4, text);
+                std::snprintf(text, sizeof(text), "LAYER REDRAWS %zu  FLATTENS %zu",
+                    layers.layers_redrawn(), layers.flattens());
+                hud.set_line(5, text);
+                std::snprintf(text, sizeof(text), "H: TOGGLE HUD  ESC: QUIT");
+                hud.set_line(6, text);
+            }
+            hud.draw(gfx.pixels);
+            hud_ms = end_stage("hud", stage_start, 0);
+        }
+
+        if (sink) {
+            sink->submit(gfx.pixels);
+        }
+        if (shared_frames) {
+            shared_frames->publish(gfx.pixels);
+        }
+
+        stage_start = begin_stage();
+        gfx.render_nondestructive();
+        present_ms = end_stage("present", stage_start, NUM_PIXELS);
+    };
+    auto on_key = [&](const int key) {
+        if (key == SDLK_h) {
+            show_hud = !show_hud;
+        }
+    };
+    run_frame_loop(loop_config, stats, update, render, on_key);
+    std::cout << "Real-time loop: " << stats.total_count() << " frames, "
+              << "worst " << stats.total_worst() << " ms; "
+              << "last " << stats.count() << " frames: "
+              << "mean " << stats.mean() << " ms, "
+              << "p95 " << stats.percentile(0.95) << " ms, "
+              << "p99 " << stats.percentile(0.99) << " ms, "
+              << "worst " << stats.worst() << " ms; "
+              << nodes_updated << " scene node updates, "
+              << layers.layers_redrawn() << " layer redraws" << std::endl;
+    if (use_dynres) {
+        std::cout << "Dynamic resolution: " << dynres.changes() << " changes, final "
+                  << dynres.width() << "x" << dynres.height() << std::endl;
+    }
+    if (profiler) {
+        profiler->report(std::cout);
+    }
+    if (shared_frames) {
+        std::cout << "Shared memory: " << shared_frames->frames_published() << " frames published" << std::endl;
+    }
+    if (sink) {
+        sink->flush();
+        std::cout << "Stream: " << sink->frames_submitted() << " frames, "
+                  << sink->frames_written() << " written, " << sink->frames_dropped() << " dropped, "
+                  << sink->stalls() << " stalls (" << sink->stall_ms() << " ms blocked)" << std::endl;
+    }
+}
+
+// Compares the IDs in vis against a per-pixel reference: each
+// triangle's exact depth at the pixel, from barycentric weights in
+// double precision. Pixels where the two depths are too close to call
+// are not counted.
+std::size_t count_visibility_errors(const VisibilityBuffer& vis, const std::vector<Triangle3D>& tris)
+{
+    struct Projected {
+        SDL_Point v[3];
+        double inv_z[3];
+        double area;
+    };
+    std::vector<Projected> projected;
+    for (const Triangle3D& t : tris) {
+        Projected p = {{project_special(t.a), project_special(t.b), project_special(t.c)},
+            {1.0 / t.a.z, 1.0 / t.b.z, 1.0 / t.c.z}, 0.0};
+        p.area = static_cast<double>(p.v[1].x - p.v[0].x) * (p.v[2].y - p.v[0].y)
+            - static_cast<double>(p.v[2].x - p.v[0].x) * (p.v[1].y - p.v[0].y);
+        projected.push_back(p);
+    }
+    // 1/z at (x, y), which is linear in screen space
+    auto inv_depth = [&](const std::uint32_t id, const int x, const int y) {
+        const Projected& p = projected[id];
+        if (p.area == 0.0) {
+            return (p.inv_z[0] + p.inv_z[1] + p.inv_z[2]) / 3.0;
+        }
+        double total = 0.0;
+        for (int i = 0; i < 3; i++) {
+            const SDL_Point& a = p.v[(i + 1) % 3];
+            const SDL_Point& b = p.v[(i + 2) % 3];
+            const double w = (static_cast<double>(b.x - a.x) * (y - a.y) - static_cast<double>(b.y - a.y) * (x - a.x)) / p.area;
+            total += w * p.inv_z[i];
+        }
+        return total;
+    };
+
+    // Coverage of each triangle on its own, nearest (largest 1/z) kept
+    const std::size_t size = static_cast<std::size_t>(vis.width()) * vis.height();
+    std::vector<double> best(size, 0.0);
+    std::vector<std::uint32_t> best_id(size, VisibilityBuffer::NO_TRIANGLE);
+    VisibilityBuffer single(vis.width(), vis.height());
+    for (std::size_t i = 0; i < tris.size(); i++) {
+        const std::uint32_t id = static_cast<std::uint32_t>(i);
+        single.clear();
+        draw_triangle_visibility(single, id, tris[i].a, tris[i].b, tris[i].c);
+        for (int y = 0; y < vis.height(); y++) {
+            int x0;
+            int x1;
+            if (!single.row_extent(y, x0, x1)) {
+                continue;
+            }
+            for (int x = x0; x <= x1; x++) {
+                const std::size_t at = static_cast<std::size_t>(y) * vis.width() + x;
+                if (single.id(x, y) != id) {
+                    continue;
+                }
+                const double d = inv_depth(id, x, y);
+                if (best_id[at] == VisibilityBuffer::NO_TRIANGLE || d > best[at]) {
+                    best[at] = d;
+                    best_id[at] = id;
+                }
+            }
+        }
+    }
+
+    std::size_t errors = 0;
+    for (int y = 0; y < vis.height(); y++) {
+        for (int x = 0; x < vis.width(); x++) {
+            const std::size_t at = static_cast<std::size_t>(y) * vis.width() + x;
+            const std::uint32_t id = vis.id(x, y);
+            if (id == best_id[at]) {
+                continue;
+            }
+            if (id == VisibilityBuffer::NO_TRIANGLE || best_id[at] == VisibilityBuffer::NO_TRIANGLE
+                || best[at] - inv_depth(id, x, y) > 1e-5 * best[at]) {
+                errors++;
+            }
+        }
+    }
+    return errors;
 }
 
 bool wait_for_input()
@@ -0,0 +1,163 @@
+#include "matrix.hpp"
+#include "constants.hpp"
+#include <cmath>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+Mat4 identity_matrix()
+{
+    return {{
+        1, 0, 0, 0,
+        0, 1, 0, 0,
+        0, 0, 1, 0,
+        0, 0, 0, 1
+    }};
+}
+
+Mat4 translation_matrix(const float x, const float y, const float z)
+{
+    return {{
+        1, 0, 0, 0,
+        0, 1, 0, 0,
+        0, 0, 1, 0,
+        x, y, z, 1
+    }};
+}
+
+Mat4 scale_matrix(const float x, const float y, const float z)
+{
+    return {{
+        x, 0, 0, 0,
+        0, y, 0, 0,
+        0, 0, z, 0,
+        0, 0, 0, 1
+    }};
+}
+
+Mat4 rotation_x_matrix(const float radians)
+{
+    const float c = std::cos(radians);
+    const float s = std::sin(radians);
+    return {{
+        1,  0, 0, 0,
+        0,  c, s, 0,
+        0, -s, c, 0,
+        0,  0, 0, 1
+    }};
+}
+
+Mat4 rotation_y_matrix(const float radians)
+{
+    const float c = std::cos(radians);
+    const float s = std::sin(radians);
+    return {{
+        c, 0, -s, 0,
+        0, 1,  0, 0,
+        s, 0,  c, 0,
+        0, 0,  0, 1
+    }};
+}
+
+Mat4 rotation_z_matrix(const float radians)
+{
+    const float c = std::cos(radians);
+    const float s = std::sin(radians);
+    return {{
+         c, s, 0, 0,
+        -s, c, 0, 0,
+         0, 0, 1, 0,
+         0, 0, 0, 1
+    }};
+}
+
+Mat4 perspective_matrix()
+{
+    const float sx = D * (SCREEN_WIDTH / VIEWPORT_SIZE);
+    const float sy = D * (SCREEN_HEIGHT / VIEWPORT_SIZE) * ASPECT_RATIO;
+    return {{
+        sx,  0, 0, 0,
+         0, sy, 0, 0,
+         0,  0, 1, 1,
+         0,  0, 0, 0
+    }};
+}
+
+// Each result column is a linear combination of a's columns
+// weighted by one column of b, which maps directly onto 4-wide SIMD.
+Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+    Mat4 r;
+#if defined(__SSE__)
+    const __m128 c0 = _mm_load_ps(a.m);
+    const __m128 c1 = _mm_load_ps(a.m + 4);
+    const __m128 c2 = _mm_load_ps(a.m + 8);
+    const __m128 c3 = _mm_load_ps(a.m + 12);
+    for (int j = 0; j < 4; j++) {
+        const float* bj = b.m + 4 * j;
+        __m128 col = _mm_mul_ps(c0, _mm_set1_ps(bj[0]));
+        col = _mm_add_ps(col, _mm_mul_ps(c1, _mm_set1_ps(bj[1])));
+        col = _mm_add_ps(col, _mm_mul_ps(c2, _mm_set1_ps(bj[2])));
+        col = _mm_add_ps(col, _mm_mul_ps(c3, _mm_set1_ps(bj[3])));
+        _mm_store_ps(r.m + 4 * j, col);
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t c0 = vld1q_f32(a.m);
+    const float32x4_t c1 = vld1q_f32(a.m + 4);
+    const float32x4_t c2 = vld1q_f32(a.m + 8);
+    const float32x4_t c3 = vld1q_f32(a.m + 12);
+    for (int j = 0; j < 4; j++) {
+        const float* bj = b.m + 4 * j;
+        float32x4_t col = vmulq_n_f32(c0, bj[0]);
+        col = vmlaq_n_f32(col, c1, bj[1]);
+        col = vmlaq_n_f32(col, c2, bj[2]);
+        col = vmlaq_n_f32(col, c3, bj[3]);
+        vst1q_f32(r.m + 4 * j, col);
+    }
+#else
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 4; i++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a.m[4 * k + i] * b.m[4 * j + k];
+            }
+            r.m[4 * j + i] = sum;
+        }
+    }
+#endif
+    return r;
+}
+
+Vec4 operator*(const Mat4& a, const Vec4& v)
+{
+    Vec4 r;
+#if defined(__SSE__)
+    __m128 col = _mm_mul_ps(_mm_load_ps(a.m), _mm_set1_ps(v.x));
+    col = _mm_add_ps(col, _mm_mul_ps(_mm_load_ps(a.m + 4), _mm_set1_ps(v.y)));
+    col = _mm_add_ps(col, _mm_mul_ps(_mm_load_ps(a.m + 8), _mm_set1_ps(v.z)));
+    col = _mm_add_ps(col, _mm_mul_ps(_mm_load_ps(a.m + 12), _mm_set1_ps(v.w)));
+    _mm_store_ps(&r.x, col);
+#elif defined(__ARM_NEON)
+    float32x4_t col = vmulq_n_f32(vld1q_f32(a.m), v.x);
+    col = vmlaq_n_f32(col, vld1q_f32(a.m + 4), v.y);
+    col = vmlaq_n_f32(col, vld1q_f32(a.m + 8), v.z);
+    col = vmlaq_n_f32(col, vld1q_f32(a.m + 12), v.w);
+    vst1q_f32(&r.x, col);
+#else
+    r.x = a.m[0] * v.x + a.m[4] * v.y + a.m[8] * v.z + a.m[12] * v.w;
+    r.y = a.m[1] * v.x + a.m[5] * v.y + a.m[9] * v.z + a.m[13] * v.w;
+    r.z = a.m[2] * v.x + a.m[6] * v.y + a.m[10] * v.z + a.m[14] * v.w;
+    r.w = a.m[3] * v.x + a.m[7] * v.y + a.m[11] * v.z + a.m[15] * v.w;
+#endif
+    return r;
+}
+
+void transform_points(const Mat4& a, const Point3D* points, const std::size_t count, Vec4* out)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        out[i] = a * Vec4{points[i].x, points[i].y, points[i].z, 1.0f};
+    }
+}
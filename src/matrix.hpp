@@ -0,0 +1,37 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include "point.hpp"
+#include <cstddef>
+
+struct alignas(16) Vec4 {
+    float x;
+    float y;
+    float z;
+    float w;
+};
+
+// Column-major 4x4 matrix: column j is m[4 * j] through m[4 * j + 3].
+// Points are column vectors, so a * b applies b first.
+struct alignas(16) Mat4 {
+    float m[16];
+};
+
+Mat4 identity_matrix();
+Mat4 translation_matrix(const float x, const float y, const float z);
+Mat4 scale_matrix(const float x, const float y, const float z);
+Mat4 rotation_x_matrix(const float radians);
+Mat4 rotation_y_matrix(const float radians);
+Mat4 rotation_z_matrix(const float radians);
+
+// Same perspective as project_vertex(): x and y are scaled by D / z
+// and the viewport-to-canvas ratio, leaving z in w for the divide.
+Mat4 perspective_matrix();
+
+Mat4 operator*(const Mat4& a, const Mat4& b);
+Vec4 operator*(const Mat4& a, const Vec4& v);
+
+// Transforms count points (w = 1) into out.
+void transform_points(const Mat4& a, const Point3D* points, const std::size_t count, Vec4* out);
+
+#endif
@@ -0,0 +1,197 @@
+#include "overdraw.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+// Heatmap ramp, from no writes to the hottest value
+static constexpr std::uint32_t HEAT_RAMP[] = {
+    0xFF000000, // black
+    0xFF0000FF, // blue
+    0xFF00FFFF, // cyan
+    0xFF00FF00, // green
+    0xFFFFFF00, // yellow
+    0xFFFF0000, // red
+    0xFFFFFFFF  // white
+};
+static constexpr int HEAT_STEPS = static_cast<int>(sizeof(HEAT_RAMP) / sizeof(HEAT_RAMP[0])) - 1;
+// Write counts reach white at this many writes
+static constexpr std::uint32_t HEAT_MAX_WRITES = 16;
+
+static std::uint32_t heat_color(float t)
+{
+    t = std::clamp(t, 0.0f, 1.0f) * HEAT_STEPS;
+    const int i = std::min(static_cast<int>(t), HEAT_STEPS - 1);
+    const float f = t - i;
+    const std::uint32_t a = HEAT_RAMP[i];
+    const std::uint32_t b = HEAT_RAMP[i + 1];
+    std::uint32_t color = 0xFF000000;
+    for (int shift = 0; shift < 24; shift += 8) {
+        const float ca = (a >> shift) & 0xFF;
+        const float cb = (b >> shift) & 0xFF;
+        color |= static_cast<std::uint32_t>(ca + (cb - ca) * f + 0.5f) << shift;
+    }
+    return color;
+}
+
+OverdrawMap::OverdrawMap(const int width, const int height)
+    : w(width),
+      h(height),
+      tiles_x((width + TILE_SIZE - 1) / TILE_SIZE),
+      tiles_y((height + TILE_SIZE - 1) / TILE_SIZE),
+      counts(static_cast<std::size_t>(width) * height, 0),
+      tile_costs(static_cast<std::size_t>(tiles_x) * tiles_y, 0.0),
+      pending(tile_costs.size(), 0),
+      pending_pixels(0)
+{
+}
+
+void OverdrawMap::clear()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+    std::fill(tile_costs.begin(), tile_costs.end(), 0.0);
+    std::fill(pending.begin(), pending.end(), 0);
+    pending_tiles.clear();
+    pending_pixels = 0;
+}
+
+void OverdrawMap::add_span(const int y, int x0, int x1)
+{
+    if (y < 0 || y >= h) {
+        return;
+    }
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, w - 1);
+    if (x0 > x1) {
+        return;
+    }
+    std::uint32_t* row = counts.data() + static_cast<std::size_t>(y) * w;
+    for (int x = x0; x <= x1; x++) {
+        row[x]++;
+    }
+
+    // Split the span at tile boundaries for the cost tally
+    const int tile_row = (y / TILE_SIZE) * tiles_x;
+    for (int x = x0; x <= x1;) {
+        const int tile = tile_row + x / TILE_SIZE;
+        const int tile_end = std::min(x1, (x / TILE_SIZE + 1) * TILE_SIZE - 1);
+        if (pending[tile] == 0) {
+            pending_tiles.push_back(tile);
+        }
+        pending[tile] += tile_end - x + 1;
+        x = tile_end + 1;
+    }
+    pending_pixels += x1 - x0 + 1;
+}
+
+void OverdrawMap::add_cost(const double cost)
+{
+    for (const int tile : pending_tiles) {
+        if (pending_pixels > 0) {
+            tile_costs[tile] += cost * pending[tile] / pending_pixels;
+        }
+        pending[tile] = 0;
+    }
+    pending_tiles.clear();
+    pending_pixels = 0;
+}
+
+int OverdrawMap::width() const
+{
+    return w;
+}
+
+int OverdrawMap::height() const
+{
+    return h;
+}
+
+std::uint32_t OverdrawMap::writes(const int x, const int y) const
+{
+    return counts[static_cast<std::size_t>(y) * w + x];
+}
+
+OverdrawStats OverdrawMap::stats(const std::size_t hottest_tiles) const
+{
+    OverdrawStats s = {0, 0, 0.0, 0, {}};
+    std::vector<OverdrawTile> tiles(tile_costs.size());
+    for (int ty = 0; ty < tiles_y; ty++) {
+        for (int tx = 0; tx < tiles_x; tx++) {
+            tiles[ty * tiles_x + tx] = {tx * TILE_SIZE, ty * TILE_SIZE, 0, tile_costs[ty * tiles_x + tx]};
+        }
+    }
+    for (int y = 0; y < h; y++) {
+        const std::uint32_t* row = counts.data() + static_cast<std::size_t>(y) * w;
+        OverdrawTile* tile_row = tiles.data() + (y / TILE_SIZE) * tiles_x;
+        for (int x = 0; x < w; x++) {
+            s.writes += row[x];
+            s.covered += row[x] != 0;
+            s.max = std::max(s.max, row[x]);
+            tile_row[x / TILE_SIZE].writes += row[x];
+        }
+    }
+    s.average = s.covered > 0 ? static_cast<double>(s.writes) / s.covered : 0.0;
+
+    // Tiles nothing was drawn to are never among the hottest
+    tiles.erase(std::remove_if(tiles.begin(), tiles.end(), [](const OverdrawTile& t) {
+        return t.writes == 0 && t.cost == 0.0;
+    }), tiles.end());
+    const bool by_cost = std::any_of(tiles.begin(), tiles.end(), [](const OverdrawTile& t) { return t.cost > 0.0; });
+    const std::size_t n = std::min(hottest_tiles, tiles.size());
+    std::partial_sort(tiles.begin(), tiles.begin() + n, tiles.end(), [&](const OverdrawTile& a, const OverdrawTile& b) {
+        return by_cost ? a.cost > b.cost : a.writes > b.writes;
+    });
+    s.hottest.assign(tiles.begin(), tiles.begin() + n);
+    return s;
+}
+
+void OverdrawMap::draw_heatmap(std::vector<std::uint32_t>& pixels) const
+{
+    pixels.resize(counts.size());
+    // Log scale, so 1 and 2 writes are as far apart as 8 and 16
+    const float scale = 1.0f / std::log2(1.0f + HEAT_MAX_WRITES);
+    std::uint32_t palette[HEAT_MAX_WRITES + 1];
+    for (std::uint32_t i = 0; i <= HEAT_MAX_WRITES; i++) {
+        palette[i] = heat_color(std::log2(1.0f + i) * scale);
+    }
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        pixels[i] = palette[std::min(counts[i], HEAT_MAX_WRITES)];
+    }
+}
+
+void OverdrawMap::draw_cost_heatmap(std::vector<std::uint32_t>& pixels) const
+{
+    pixels.resize(counts.size());
+    const double max_cost = *std::max_element(tile_costs.begin(), tile_costs.end());
+    for (int y = 0; y < h; y++) {
+        std::uint32_t* row = pixels.data() + static_cast<std::size_t>(y) * w;
+        for (int tx = 0; tx < tiles_x; tx++) {
+            const double cost = tile_costs[(y / TILE_SIZE) * tiles_x + tx];
+            const std::uint32_t color = heat_color(max_cost > 0.0 ? static_cast<float>(cost / max_cost) : 0.0f);
+            std::fill(row + tx * TILE_SIZE, row + std::min(w, (tx + 1) * TILE_SIZE), color);
+        }
+    }
+}
+
+void write_ppm(const std::string& path, const std::vector<std::uint32_t>& pixels, const int width, const int height)
+{
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("write_ppm: can't open " + path);
+    }
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row(static_cast<std::size_t>(width) * 3);
+    bool ok = true;
+    for (int y = 0; y < height && ok; y++) {
+        for (int x = 0; x < width; x++) {
+            const std::uint32_t p = pixels[static_cast<std::size_t>(y) * width + x];
+            row[x * 3] = (p >> 16) & 0xFF;
+            row[x * 3 + 1] = (p >> 8) & 0xFF;
+            row[x * 3 + 2] = p & 0xFF;
+        }
+        ok = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    if (std::fclose(file) != 0 || !ok) {
+        throw std::runtime_error("write_ppm: can't write " + path);
+    }
+}
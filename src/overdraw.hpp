@@ -0,0 +1,76 @@
+#ifndef OVERDRAW_H
+#define OVERDRAW_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+struct OverdrawTile {
+    int x;
+    int y;
+    std::uint64_t writes;
+    double cost;
+};
+
+struct OverdrawStats {
+    // Pixel writes, and pixels written at least once
+    std::uint64_t writes;
+    std::uint64_t covered;
+    // writes / covered: 1.0 means every pixel was written exactly once
+    double average;
+    std::uint32_t max;
+    // Hottest tiles first: by cost if any was recorded, else by writes
+    std::vector<OverdrawTile> hottest;
+};
+
+// Debug side buffer counting how many times each pixel is written,
+// plus an optional cost (e.g. cycles or nanoseconds) per
+// TILE_SIZE x TILE_SIZE tile. Rasterizers report their writes with
+// add_span(); add_cost() then spreads the cost of the primitive that
+// made them over the tiles it touched, in proportion to its pixels.
+// Only draw_filled_triangle_overdraw() reports writes, and it models
+// draw_filled_triangle_bres() alone: its row fills, and the full
+// SMALL_TRIANGLE_SIZE-wide masked rows its SIMD path stores for small
+// triangles. Lines, draw_filled_triangle(), draw_shaded_triangle() and
+// the span and visibility buffers are not counted.
+class OverdrawMap {
+public:
+    static constexpr int TILE_SIZE = 32;
+
+    OverdrawMap(const int width, const int height);
+
+    int width() const;
+    int height() const;
+
+    void clear();
+    // Counts one write to each pixel from x0 to x1 inclusive
+    void add_span(const int y, int x0, int x1);
+    void add_cost(const double cost);
+
+    std::uint32_t writes(const int x, const int y) const;
+    OverdrawStats stats(const std::size_t hottest_tiles = 5) const;
+
+    // Color-ramped write counts (black, blue, cyan, green, yellow,
+    // red, then white at 16 or more writes), one pixel per pixel
+    void draw_heatmap(std::vector<std::uint32_t>& pixels) const;
+    // The same ramp over per-tile cost, relative to the costliest tile
+    void draw_cost_heatmap(std::vector<std::uint32_t>& pixels) const;
+
+private:
+    int w;
+    int h;
+    int tiles_x;
+    int tiles_y;
+    std::vector<std::uint32_t> counts;
+    std::vector<double> tile_costs;
+    // Pixels written per tile since the last add_cost()
+    std::vector<std::uint32_t> pending;
+    std::vector<int> pending_tiles;
+    std::uint64_t pending_pixels;
+};
+
+// Writes an ARGB8888 image as a binary PPM; throws on failure
+void write_ppm(const std::string& path, const std::vector<std::uint32_t>& pixels, const int width, const int height);
+
+#endif
@@ -0,0 +1,247 @@
+#include "perfcounters.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char* PERF_EVENT_NAMES[NUM_PERF_EVENTS] = {
+    "cycles",
+    "instructions",
+    "L1D misses",
+    "LLC misses",
+    "branch misses"
+};
+
+#if defined(__linux__)
+static int open_perf_event(const std::uint32_t type, const std::uint64_t config, const int group)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+#endif
+
+PerfCounters::PerfCounters()
+    : leader(-1), num_open(0)
+{
+    fds.fill(-1);
+    slots.fill(-1);
+#if defined(__linux__)
+    struct EventConfig {
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+    static constexpr std::uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D
+        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    static constexpr EventConfig configs[NUM_PERF_EVENTS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, l1d_read_miss},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+    };
+
+    // Cycles lead the group; without them nothing else is useful
+    leader = open_perf_event(configs[0].type, configs[0].config, -1);
+    if (leader < 0) {
+        why_unavailable = std::string("perf_event_open: ") + std::strerror(errno);
+        if (errno == EACCES || errno == EPERM) {
+            why_unavailable += " (see /proc/sys/kernel/perf_event_paranoid)";
+        }
+        return;
+    }
+    fds[0] = leader;
+    slots[0] = num_open++;
+    // Events this CPU doesn't have are simply left out of the group
+    for (std::size_t i = 1; i < NUM_PERF_EVENTS; i++) {
+        fds[i] = open_perf_event(configs[i].type, configs[i].config, leader);
+        if (fds[i] >= 0) {
+            slots[i] = num_open++;
+        }
+    }
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    why_unavailable = "hardware counters need Linux perf_event_open";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+    for (const int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::available() const
+{
+    return leader >= 0;
+}
+
+bool PerfCounters::has(const PerfEvent e) const
+{
+    return slots[static_cast<std::size_t>(e)] >= 0;
+}
+
+const std::string& PerfCounters::reason() const
+{
+    return why_unavailable;
+}
+
+PerfReading PerfCounters::read() const
+{
+    PerfReading reading;
+#if defined(__linux__)
+    if (leader < 0) {
+        return reading;
+    }
+    // nr, time_enabled, time_running, then one value per open event
+    std::uint64_t buffer[3 + NUM_PERF_EVENTS];
+    const ssize_t expected = static_cast<ssize_t>((3 + num_open) * sizeof(std::uint64_t));
+    if (::read(leader, buffer, sizeof(buffer)) != expected) {
+        return reading;
+    }
+    reading.time_enabled = buffer[1];
+    reading.time_running = buffer[2];
+    reading.valid = true;
+    for (std::size_t i = 0; i < NUM_PERF_EVENTS; i++) {
+        if (slots[i] >= 0) {
+            reading.values[i] = buffer[3 + slots[i]];
+        }
+    }
+#endif
+    return reading;
+}
+
+PerfReading PerfReading::since(const PerfReading& start) const
+{
+    PerfReading delta;
+    if (!valid || !start.valid) {
+        return delta;
+    }
+    delta.valid = true;
+    delta.time_enabled = time_enabled - start.time_enabled;
+    delta.time_running = time_running - start.time_running;
+    for (std::size_t i = 0; i < NUM_PERF_EVENTS; i++) {
+        std::uint64_t value = values[i] - start.values[i];
+        if (delta.time_running > 0 && delta.time_running < delta.time_enabled) {
+            value = static_cast<std::uint64_t>(static_cast<double>(value) * delta.time_enabled / delta.time_running);
+        }
+        delta.values[i] = value;
+    }
+    return delta;
+}
+
+void StageProfiler::begin()
+{
+    start_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count());
+    start_reading = perf.read();
+}
+
+void StageProfiler::end(const std::string& stage, const std::uint64_t pixels)
+{
+    const PerfReading delta = perf.read().since(start_reading);
+    const std::uint64_t end_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count());
+    Stage& s = find(stage);
+    s.calls++;
+    s.pixels += pixels;
+    s.ms += (end_ns - start_ns) / 1e6;
+    if (!delta.valid) {
+        s.failed_reads += perf.available() ? 1 : 0;
+        return;
+    }
+    for (std::size_t i = 0; i < NUM_PERF_EVENTS; i++) {
+        s.totals.values[i] += delta.values[i];
+    }
+}
+
+StageProfiler::Stage& StageProfiler::find(const std::string& name)
+{
+    for (Stage& s : stages) {
+        if (s.name == name) {
+            return s;
+        }
+    }
+    stages.push_back({name, 0, 0, 0.0, PerfReading(), 0});
+    return stages.back();
+}
+
+const PerfCounters& StageProfiler::counters() const
+{
+    return perf;
+}
+
+void StageProfiler::report(std::ostream& out) const
+{
+    if (!perf.available()) {
+        out << "Hardware counters unavailable: " << perf.reason() << "\n";
+    } else {
+        for (std::size_t i = 0; i < NUM_PERF_EVENTS; i++) {
+            if (!perf.has(static_cast<PerfEvent>(i))) {
+                out << "Counter unavailable: " << PERF_EVENT_NAMES[i] << "\n";
+            }
+        }
+    }
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-24s %8s %12s %10s %10s %6s %10s %10s %10s\n",
+        "stage", "calls", "pixels", "ms", "Mcycles", "IPC", "L1D/px", "LLC/px", "brmiss/px");
+    out << line;
+    for (const Stage& s : stages) {
+        auto column = [&](const PerfEvent e, const double value, const char* format) {
+            char text[16] = "";
+            if (perf.has(e) && s.failed_reads == 0) {
+                std::snprintf(text, sizeof(text), format, value);
+            }
+            return std::string(text);
+        };
+        auto per_pixel = [&](const PerfEvent e) {
+            if (s.pixels == 0) {
+                return std::string();
+            }
+            return column(e, static_cast<double>(s.totals[e]) / s.pixels, "%.4f");
+        };
+        const double cycles = static_cast<double>(s.totals[PerfEvent::cycles]);
+        const double ipc = cycles > 0 ? s.totals[PerfEvent::instructions] / cycles : 0.0;
+        std::snprintf(line, sizeof(line), "%-24s %8llu %12llu %10.3f %10s %6s %10s %10s %10s\n",
+            s.name.c_str(),
+            static_cast<unsigned long long>(s.calls),
+            static_cast<unsigned long long>(s.pixels),
+            s.ms,
+            column(PerfEvent::cycles, cycles / 1e6, "%.2f").c_str(),
+            perf.has(PerfEvent::instructions) ? column(PerfEvent::cycles, ipc, "%.2f").c_str() : "",
+            per_pixel(PerfEvent::l1d_misses).c_str(),
+            per_pixel(PerfEvent::llc_misses).c_str(),
+            per_pixel(PerfEvent::branch_misses).c_str()
+        );
+        out << line;
+    }
+    for (const Stage& s : stages) {
+        if (s.failed_reads > 0) {
+            out << s.name << ": " << s.failed_reads << " counter reads failed, counters omitted\n";
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class PerfEvent {
+    cycles,
+    instructions,
+    l1d_misses,
+    llc_misses,
+    branch_misses
+};
+
+constexpr std::size_t NUM_PERF_EVENTS = 5;
+
+// Snapshot of the calling thread's hardware counters, user space only,
+// taken with one read of the whole group. An event the CPU or kernel
+// doesn't provide reads as 0 and is flagged in PerfCounters::has().
+struct PerfReading {
+    // Raw counts, not scaled for multiplexing
+    std::array<std::uint64_t, NUM_PERF_EVENTS> values{};
+    // Nanoseconds the group was enabled and actually counting
+    std::uint64_t time_enabled = 0;
+    std::uint64_t time_running = 0;
+    // False if the counters are unavailable or the read failed
+    bool valid = false;
+
+    std::uint64_t operator[](const PerfEvent e) const
+    {
+        return values[static_cast<std::size_t>(e)];
+    }
+
+    // Counts between start and this reading. If the kernel multiplexed
+    // the group in between, they are scaled up by how much of that
+    // interval it was actually counting. Invalid and all zero if either
+    // reading is invalid.
+    PerfReading since(const PerfReading& start) const;
+};
+
+// One perf_event_open group counting the PerfEvent events on the
+// calling thread. If counters can't be opened (not Linux, no PMU in a
+// VM, or a perf_event_paranoid setting that forbids it), available()
+// is false, reason() says why, and read() returns invalid readings.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const;
+    bool has(const PerfEvent e) const;
+    const std::string& reason() const;
+
+    // Counts so far; use PerfReading::since() for the counts of an interval
+    PerfReading read() const;
+
+private:
+    int leader;
+    std::array<int, NUM_PERF_EVENTS> fds;
+    // Position of each event in a group read, or -1
+    std::array<int, NUM_PERF_EVENTS> slots;
+    int num_open;
+    std::string why_unavailable;
+};
+
+// Accumulates wall time and counter deltas for named stages.
+// Wrap each stage in begin() / end(); pixels is how many pixels the
+// stage produced, for the per-pixel columns of the report.
+class StageProfiler {
+public:
+    void begin();
+    void end(const std::string& stage, const std::uint64_t pixels = 0);
+
+    // One row per stage: calls, time, IPC and misses per pixel.
+    // Columns for unavailable counters are left blank, as are all
+    // counter columns of a stage where a counter read failed.
+    void report(std::ostream& out) const;
+
+    const PerfCounters& counters() const;
+
+private:
+    struct Stage {
+        std::string name;
+        std::uint64_t calls;
+        std::uint64_t pixels;
+        double ms;
+        PerfReading totals;
+        std::uint64_t failed_reads;
+    };
+
+    PerfCounters perf;
+    std::vector<Stage> stages;
+    PerfReading start_reading;
+    std::uint64_t start_ns = 0;
+
+    Stage& find(const std::string& name);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef PIXELFORMAT_H
+#define PIXELFORMAT_H
+
+#include <cstdint>
+#include <SDL2/SDL.h>
+
+// Pixel format traits. Each format knows its storage type, the matching
+// SDL texture format, and how to encode an ARGB8888 color at a given
+// screen position. Formats with fewer than 8 bits per channel apply a
+// 4x4 ordered (Bayer) dither when encoding, so encode() depends on x and y
+// with a period of dither_period pixels in each direction.
+
+constexpr std::uint8_t BAYER_4X4[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5}
+};
+
+// Quantizes an 8-bit channel to [0, max_level], using the Bayer
+// matrix entry for (x, y) as the rounding threshold.
+template <std::uint32_t max_level>
+constexpr std::uint32_t dither_channel(const std::uint32_t c, const int x, const int y)
+{
+    const std::uint32_t threshold = ((BAYER_4X4[y & 3][x & 3] * 2 + 1) * 255) / 32;
+    return (c * max_level + threshold) / 255;
+}
+
+// Expands a channel quantized to [0, max_level] back to 8 bits.
+template <std::uint32_t max_level>
+constexpr std::uint32_t expand_channel(const std::uint32_t q)
+{
+    return (q * 255 + max_level / 2) / max_level;
+}
+
+struct FormatARGB8888 {
+    using pixel_type = std::uint32_t;
+    static constexpr std::uint32_t sdl_format = SDL_PIXELFORMAT_ARGB8888;
+    static constexpr int dither_period = 1;
+
+    static constexpr pixel_type encode(const std::uint32_t argb, const int, const int)
+    {
+        return argb;
+    }
+
+    static constexpr std::uint32_t decode(const pixel_type p)
+    {
+        return p;
+    }
+};
+
+struct FormatRGB565 {
+    using pixel_type = std::uint16_t;
+    static constexpr std::uint32_t sdl_format = SDL_PIXELFORMAT_RGB565;
+    static constexpr int dither_period = 4;
+
+    static constexpr pixel_type encode(const std::uint32_t argb, const int x, const int y)
+    {
+        const std::uint32_t r = dither_channel<31>((argb >> 16) & 0xFF, x, y);
+        const std::uint32_t g = dither_channel<63>((argb >> 8) & 0xFF, x, y);
+        const std::uint32_t b = dither_channel<31>(argb & 0xFF, x, y);
+        return static_cast<pixel_type>((r << 11) | (g << 5) | b);
+    }
+
+    static constexpr std::uint32_t decode(const pixel_type p)
+    {
+        const std::uint32_t r = (p >> 11) & 0x1F;
+        const std::uint32_t g = (p >> 5) & 0x3F;
+        const std::uint32_t b = p & 0x1F;
+        return 0xFF000000
+            | (expand_channel<31>(r) << 16)
+            | (expand_channel<63>(g) << 8)
+            | expand_channel<31>(b);
+    }
+};
+
+// 8-bit palettized output using the fixed 3-3-2 palette,
+// which SDL can upload directly as SDL_PIXELFORMAT_RGB332.
+struct FormatRGB332 {
+    using pixel_type = std::uint8_t;
+    static constexpr std::uint32_t sdl_format = SDL_PIXELFORMAT_RGB332;
+    static constexpr int dither_period = 4;
+
+    static constexpr pixel_type encode(const std::uint32_t argb, const int x, const int y)
+    {
+        const std::uint32_t r = dither_channel<7>((argb >> 16) & 0xFF, x, y);
+        const std::uint32_t g = dither_channel<7>((argb >> 8) & 0xFF, x, y);
+        const std::uint32_t b = dither_channel<3>(argb & 0xFF, x, y);
+        return static_cast<pixel_type>((r << 5) | (g << 2) | b);
+    }
+
+    static constexpr std::uint32_t decode(const pixel_type p)
+    {
+        const std::uint32_t r = (p >> 5) & 0x7;
+        const std::uint32_t g = (p >> 2) & 0x7;
+        const std::uint32_t b = p & 0x3;
+        return 0xFF000000
+            | (expand_channel<7>(r) << 16)
+            | (expand_channel<7>(g) << 8)
+            | expand_channel<3>(b);
+    }
+};
+
+#endif
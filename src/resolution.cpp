@@ -0,0 +1,66 @@
+#include "resolution.hpp"
+#include "constants.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+ResolutionScaler::ResolutionScaler(const ResolutionScalerConfig& config)
+    : config(config), recent(config.window), current_scale(config.max_scale)
+{
+    if (config.min_scale <= 0.0 || config.min_scale > config.max_scale || config.max_scale > 1.0) {
+        throw std::runtime_error("ResolutionScaler: scale bounds must satisfy 0 < min <= max <= 1");
+    }
+    if (config.low_water >= config.high_water) {
+        throw std::runtime_error("ResolutionScaler: low water mark must be below the high water mark");
+    }
+}
+
+bool ResolutionScaler::add_frame(const double render_ms)
+{
+    recent.add(render_ms);
+    if (recent.count() < config.window) {
+        return false;
+    }
+
+    const double cost = recent.mean();
+    const double prev_scale = current_scale;
+    if (cost > config.high_water * config.budget_ms) {
+        // Aim for the middle of the band, so the new
+        // resolution doesn't immediately trigger a step up
+        const double target = 0.5 * (config.low_water + config.high_water) * config.budget_ms;
+        set_scale(current_scale * std::sqrt(target / cost));
+    } else if (cost < config.low_water * config.budget_ms) {
+        set_scale(current_scale + config.step_up);
+    }
+    if (current_scale == prev_scale) {
+        return false;
+    }
+    recent = FrameStats(config.window);
+    change_count++;
+    return true;
+}
+
+void ResolutionScaler::set_scale(const double s)
+{
+    current_scale = std::clamp(s, config.min_scale, config.max_scale);
+}
+
+double ResolutionScaler::scale() const
+{
+    return current_scale;
+}
+
+int ResolutionScaler::width() const
+{
+    return std::max(2, static_cast<int>(SCREEN_WIDTH * current_scale) & ~1);
+}
+
+int ResolutionScaler::height() const
+{
+    return std::max(2, static_cast<int>(SCREEN_HEIGHT * current_scale) & ~1);
+}
+
+std::size_t ResolutionScaler::changes() const
+{
+    return change_count;
+}
@@ -0,0 +1,52 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include "framestats.hpp"
+#include <cstddef>
+
+struct ResolutionScalerConfig {
+    // Milliseconds of rendering work each frame should fit in
+    double budget_ms = 8.0;
+    // Bounds of the render resolution, as a fraction of the screen size
+    double min_scale = 0.5;
+    double max_scale = 1.0;
+    // The scale drops when the average frame cost rises above
+    // high_water * budget_ms, and only rises again once it falls
+    // below low_water * budget_ms.
+    double high_water = 0.95;
+    double low_water = 0.7;
+    double step_up = 0.05;
+    // Frames averaged before each decision
+    std::size_t window = 8;
+};
+
+// Picks the internal render resolution from recent frame costs.
+// Cost is assumed to be proportional to the number of pixels, so an
+// over-budget frame rate is corrected in one step, while the scale only
+// creeps back up by step_up at a time. After every change the cost
+// history is discarded, so the next decision only sees frames
+// rendered at the new resolution.
+class ResolutionScaler {
+public:
+    explicit ResolutionScaler(const ResolutionScalerConfig& config = ResolutionScalerConfig());
+
+    // Adds the cost of the frame just rendered.
+    // Returns true if the render resolution changed.
+    bool add_frame(const double render_ms);
+
+    double scale() const;
+    // Render resolution, rounded to even sizes
+    int width() const;
+    int height() const;
+    std::size_t changes() const;
+
+private:
+    ResolutionScalerConfig config;
+    FrameStats recent;
+    double current_scale;
+    std::size_t change_count = 0;
+
+    void set_scale(const double s);
+};
+
+#endif
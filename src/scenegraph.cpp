@@ -0,0 +1,116 @@
+#include "scenegraph.hpp"
+#include "constants.hpp"
+#include <cassert>
+#include <cmath>
+
+SceneGraph::SceneGraph()
+    : view_projection(perspective_matrix()), view_projection_dirty(true)
+{
+}
+
+SceneGraph::NodeId SceneGraph::add_node(const NodeId parent)
+{
+    const NodeId id = nodes.size();
+    nodes.push_back({parent, {}, identity_matrix(), identity_matrix(), {}, {}, true, false});
+    if (parent == NO_PARENT) {
+        roots.push_back(id);
+    } else {
+        assert(parent < id);
+        nodes[parent].children.push_back(id);
+    }
+    mark_dirty(id);
+    return id;
+}
+
+void SceneGraph::set_local_transform(const NodeId id, const Mat4& local)
+{
+    nodes[id].local = local;
+    mark_dirty(id);
+}
+
+void SceneGraph::set_vertices(const NodeId id, const std::vector<Point3D>& vertices)
+{
+    nodes[id].vertices = vertices;
+    mark_dirty(id);
+}
+
+void SceneGraph::set_view_projection(const Mat4& vp)
+{
+    view_projection = vp;
+    view_projection_dirty = true;
+}
+
+const Mat4& SceneGraph::world_transform(const NodeId id) const
+{
+    return nodes[id].world;
+}
+
+const std::vector<SDL_Point>& SceneGraph::projected_vertices(const NodeId id) const
+{
+    return nodes[id].projected;
+}
+
+void SceneGraph::mark_dirty(const NodeId id)
+{
+    nodes[id].dirty = true;
+    // Flag the path to the root so update() can find this node
+    // without visiting clean subtrees. Stop early once an ancestor
+    // has already been flagged by an earlier change.
+    for (NodeId p = nodes[id].parent; p != NO_PARENT; p = nodes[p].parent) {
+        if (nodes[p].child_dirty) {
+            break;
+        }
+        nodes[p].child_dirty = true;
+    }
+}
+
+std::size_t SceneGraph::update()
+{
+    const Mat4 root_world = identity_matrix();
+    std::size_t updated = 0;
+    for (const NodeId id : roots) {
+        updated += update_subtree(id, root_world, false);
+    }
+    view_projection_dirty = false;
+    return updated;
+}
+
+std::size_t SceneGraph::update_subtree(const NodeId id, const Mat4& parent_world, const bool parent_changed)
+{
+    Node& node = nodes[id];
+    const bool changed = parent_changed || node.dirty;
+    if (!changed && !node.child_dirty && !view_projection_dirty) {
+        return 0;
+    }
+
+    std::size_t updated = 0;
+    if (changed) {
+        node.world = parent_world * node.local;
+    }
+    if (changed || view_projection_dirty) {
+        project(node);
+        updated++;
+    }
+    node.dirty = false;
+    node.child_dirty = false;
+
+    for (const NodeId child : node.children) {
+        updated += update_subtree(child, nodes[id].world, changed);
+    }
+    return updated;
+}
+
+void SceneGraph::project(Node& node)
+{
+    const Mat4 mvp = view_projection * node.world;
+    scratch.resize(node.vertices.size());
+    transform_points(mvp, node.vertices.data(), node.vertices.size(), scratch.data());
+
+    node.projected.resize(node.vertices.size());
+    for (std::size_t i = 0; i < scratch.size(); i++) {
+        const Vec4& v = scratch[i];
+        const int c_x = std::round(v.x / v.w);
+        const int c_y = std::round(v.y / v.w);
+        node.projected[i] = {X_MID_SCREEN + c_x, Y_MID_SCREEN - c_y};
+    }
+}
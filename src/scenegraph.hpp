@@ -0,0 +1,57 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include "matrix.hpp"
+#include "point.hpp"
+#include <vector>
+#include <cstddef>
+#include <SDL2/SDL.h>
+
+// Hierarchy of transform nodes, each optionally carrying model-space
+// vertices. World matrices and projected screen positions are cached
+// per node and only recomputed by update() for subtrees that changed.
+class SceneGraph {
+public:
+    using NodeId = std::size_t;
+    static constexpr NodeId NO_PARENT = static_cast<NodeId>(-1);
+
+    SceneGraph();
+
+    NodeId add_node(const NodeId parent = NO_PARENT);
+    void set_local_transform(const NodeId id, const Mat4& local);
+    void set_vertices(const NodeId id, const std::vector<Point3D>& vertices);
+    void set_view_projection(const Mat4& view_projection);
+
+    // Recomputes dirty world matrices and projections.
+    // Returns the number of nodes that were recomputed.
+    std::size_t update();
+
+    const Mat4& world_transform(const NodeId id) const;
+    const std::vector<SDL_Point>& projected_vertices(const NodeId id) const;
+
+private:
+    struct Node {
+        NodeId parent;
+        std::vector<NodeId> children;
+        Mat4 local;
+        Mat4 world;
+        std::vector<Point3D> vertices;
+        std::vector<SDL_Point> projected;
+        // This node's local transform or vertices changed
+        bool dirty;
+        // Some descendant is dirty, so update() must visit this subtree
+        bool child_dirty;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<NodeId> roots;
+    std::vector<Vec4> scratch;
+    Mat4 view_projection;
+    bool view_projection_dirty;
+
+    void mark_dirty(const NodeId id);
+    std::size_t update_subtree(const NodeId id, const Mat4& parent_world, const bool parent_changed);
+    void project(Node& node);
+};
+
+#endif
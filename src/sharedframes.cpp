@@ -0,0 +1,307 @@
+#include "sharedframes.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+constexpr std::uint32_t SHARED_FRAMES_MAGIC = 0x52465348; // "HSFR"
+constexpr std::uint32_t SHARED_FRAMES_VERSION = 1;
+constexpr std::size_t SHARED_FRAMES_PAGE = 4096;
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "seqlocks need lock-free atomics");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "seqlocks need lock-free atomics");
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "futex words are 32 bits");
+
+// Lives at the start of the segment; the frame slots follow it,
+// starting on the next page boundary. Frame n (counting from 1)
+// is written to slot n % slot_count.
+struct SharedFrameHeader {
+    // Set last by the writer, once everything else is initialized
+    std::atomic<std::uint32_t> magic;
+    std::uint32_t version;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t slot_count;
+    // Bumped after every published frame; readers sleep on it
+    std::atomic<std::uint32_t> published;
+    // Number of the most recently published frame; 0 before the first
+    std::atomic<std::uint64_t> latest;
+    struct Slot {
+        // Odd while the writer is filling the slot
+        std::atomic<std::uint32_t> sequence;
+        std::atomic<std::uint64_t> number;
+    } slots[SharedFrameWriter::MAX_SLOTS];
+};
+
+static_assert(sizeof(SharedFrameHeader) <= SHARED_FRAMES_PAGE, "header must fit in one page");
+
+static std::size_t shared_frames_size(const std::size_t width, const std::size_t height, const std::size_t slots)
+{
+    return SHARED_FRAMES_PAGE + slots * width * height * sizeof(std::uint32_t);
+}
+
+static std::runtime_error shared_frames_error(const std::string& what, const std::string& name)
+{
+    return std::runtime_error(what + " " + name + ": " + std::strerror(errno));
+}
+
+static void futex_wake_all(std::atomic<std::uint32_t>* word)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+// Sleeps while *word == expected, for at most timeout_ms
+static void futex_wait(const std::atomic<std::uint32_t>* word, const std::uint32_t expected, const int timeout_ms)
+{
+#if defined(__linux__)
+    timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    syscall(SYS_futex, reinterpret_cast<const std::uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#else
+    // No cross-process futex: poll instead
+    (void)word;
+    (void)expected;
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout_ms, 1)));
+#endif
+}
+
+SharedFrameWriter::SharedFrameWriter(
+    const std::string& name,
+    const int width,
+    const int height,
+    const int slots,
+    const bool replace_existing
+)
+    : name(name), mapping(MAP_FAILED), mapping_size(0), header(nullptr), frames(nullptr), slot(0), writing(false)
+{
+    if (width <= 0 || height <= 0 || slots < 2 || slots > MAX_SLOTS) {
+        throw std::runtime_error("SharedFrameWriter: invalid frame size or slot count");
+    }
+
+    // Always start from a fresh segment, so readers of an old one don't
+    // see it being resized under them. An existing segment may belong to
+    // a live writer, so it is only removed when the caller asks for it.
+    if (replace_existing) {
+        shm_unlink(name.c_str());
+    }
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        if (errno == EEXIST) {
+            throw std::runtime_error(
+                "SharedFrameWriter: " + name + " already exists; another writer may own it, "
+                "or an earlier run left it behind and it needs replacing"
+            );
+        }
+        throw shared_frames_error("SharedFrameWriter: can't create", name);
+    }
+    mapping_size = shared_frames_size(width, height, slots);
+    if (ftruncate(fd, static_cast<off_t>(mapping_size)) != 0) {
+        const std::runtime_error error = shared_frames_error("SharedFrameWriter: can't resize", name);
+        close(fd);
+        shm_unlink(name.c_str());
+        throw error;
+    }
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        const std::runtime_error error = shared_frames_error("SharedFrameWriter: can't map", name);
+        shm_unlink(name.c_str());
+        throw error;
+    }
+
+    // A fresh segment is zero-filled, so every sequence starts even
+    header = static_cast<SharedFrameHeader*>(mapping);
+    frames = reinterpret_cast<std::uint32_t*>(static_cast<char*>(mapping) + SHARED_FRAMES_PAGE);
+    header->version = SHARED_FRAMES_VERSION;
+    header->width = width;
+    header->height = height;
+    header->slot_count = slots;
+    header->magic.store(SHARED_FRAMES_MAGIC, std::memory_order_release);
+}
+
+SharedFrameWriter::~SharedFrameWriter()
+{
+    munmap(mapping, mapping_size);
+    shm_unlink(name.c_str());
+}
+
+std::uint32_t* SharedFrameWriter::begin_frame()
+{
+    if (writing) {
+        throw std::runtime_error("SharedFrameWriter: begin_frame() called twice");
+    }
+    const std::uint64_t number = header->latest.load(std::memory_order_relaxed) + 1;
+    slot = static_cast<int>(number % header->slot_count);
+    SharedFrameHeader::Slot& s = header->slots[slot];
+    // Mark the slot as being written before touching any pixel
+    s.sequence.store(s.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.number.store(number, std::memory_order_relaxed);
+    writing = true;
+    return frames + static_cast<std::size_t>(slot) * header->width * header->height;
+}
+
+void SharedFrameWriter::end_frame()
+{
+    if (!writing) {
+        throw std::runtime_error("SharedFrameWriter: end_frame() without begin_frame()");
+    }
+    SharedFrameHeader::Slot& s = header->slots[slot];
+    s.sequence.store(s.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    header->latest.store(s.number.load(std::memory_order_relaxed), std::memory_order_release);
+    header->published.fetch_add(1, std::memory_order_release);
+    futex_wake_all(&header->published);
+    writing = false;
+}
+
+void SharedFrameWriter::publish(const std::vector<std::uint32_t>& pixels)
+{
+    const std::size_t count = static_cast<std::size_t>(header->width) * header->height;
+    if (pixels.size() < count) {
+        throw std::runtime_error("SharedFrameWriter: frame is smaller than the segment's frames");
+    }
+    std::memcpy(begin_frame(), pixels.data(), count * sizeof(std::uint32_t));
+    end_frame();
+}
+
+std::uint64_t SharedFrameWriter::frames_published() const
+{
+    return header->latest.load(std::memory_order_relaxed);
+}
+
+SharedFrameReader::SharedFrameReader(const std::string& name)
+    : mapping(MAP_FAILED), mapping_size(0), header(nullptr), frames(nullptr), last_number(0)
+{
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw shared_frames_error("SharedFrameReader: can't open", name);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        const std::runtime_error error = shared_frames_error("SharedFrameReader: can't stat", name);
+        close(fd);
+        throw error;
+    }
+    mapping_size = static_cast<std::size_t>(st.st_size);
+    if (mapping_size < SHARED_FRAMES_PAGE) {
+        close(fd);
+        throw std::runtime_error("SharedFrameReader: " + name + " is not a frame segment");
+    }
+    mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw shared_frames_error("SharedFrameReader: can't map", name);
+    }
+
+    header = static_cast<const SharedFrameHeader*>(mapping);
+    frames = reinterpret_cast<const std::uint32_t*>(static_cast<const char*>(mapping) + SHARED_FRAMES_PAGE);
+    if (header->magic.load(std::memory_order_acquire) != SHARED_FRAMES_MAGIC
+        || header->version != SHARED_FRAMES_VERSION
+        || header->slot_count > SharedFrameWriter::MAX_SLOTS
+        || mapping_size < shared_frames_size(header->width, header->height, header->slot_count)) {
+        munmap(mapping, mapping_size);
+        throw std::runtime_error("SharedFrameReader: " + name + " is not a frame segment");
+    }
+}
+
+SharedFrameReader::~SharedFrameReader()
+{
+    munmap(mapping, mapping_size);
+}
+
+int SharedFrameReader::width() const
+{
+    return static_cast<int>(header->width);
+}
+
+int SharedFrameReader::height() const
+{
+    return static_cast<int>(header->height);
+}
+
+bool SharedFrameReader::wait_for_frame(const int timeout_ms)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true) {
+        // Read the futex word first, so a frame published
+        // after the check below still wakes us up
+        const std::uint32_t published = header->published.load(std::memory_order_acquire);
+        if (header->latest.load(std::memory_order_acquire) > last_number) {
+            return true;
+        }
+        const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()
+        ).count();
+        if (remaining <= 0) {
+            return false;
+        }
+        futex_wait(&header->published, published, static_cast<int>(remaining));
+    }
+}
+
+SharedFrameReader::Frame SharedFrameReader::acquire()
+{
+    const std::uint64_t number = header->latest.load(std::memory_order_acquire);
+    const int slot = static_cast<int>(number % header->slot_count);
+    const SharedFrameHeader::Slot& s = header->slots[slot];
+    const std::uint32_t sequence = s.sequence.load(std::memory_order_acquire);
+    if (number == 0 || sequence % 2 != 0 || s.number.load(std::memory_order_relaxed) != number) {
+        return {nullptr, number, slot, sequence};
+    }
+    last_number = number;
+    const std::uint32_t* pixels = frames + static_cast<std::size_t>(slot) * header->width * header->height;
+    return {pixels, number, slot, sequence};
+}
+
+bool SharedFrameReader::release(const Frame& frame) const
+{
+    if (frame.pixels == nullptr) {
+        return false;
+    }
+    // Orders the reads of the pixels before the second look at the sequence
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header->slots[frame.slot].sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
+
+bool SharedFrameReader::read(std::vector<std::uint32_t>& pixels, std::uint64_t* number)
+{
+    const std::size_t count = static_cast<std::size_t>(header->width) * header->height;
+    pixels.resize(count);
+    while (true) {
+        const Frame frame = acquire();
+        if (frame.number == 0) {
+            return false;
+        }
+        if (frame.pixels == nullptr) {
+            // Caught the writer mid-frame
+            std::this_thread::yield();
+            continue;
+        }
+        std::memcpy(pixels.data(), frame.pixels, count * sizeof(std::uint32_t));
+        if (release(frame)) {
+            if (number != nullptr) {
+                *number = frame.number;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef SHAREDFRAMES_H
+#define SHAREDFRAMES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct SharedFrameHeader;
+
+// Exports finished ARGB8888 frames through a POSIX shared-memory segment
+// (shm_open name, e.g. "/rasterizer") holding a ring of frame slots.
+// Each slot is guarded by a seqlock: its sequence number is odd while
+// the slot is being written. After a frame is complete, the segment's
+// publish counter is bumped and waiting readers are woken through a
+// futex on it (or poll for it, where futexes aren't available).
+// The segment is unlinked when the writer is destroyed.
+//
+// Creating a writer fails if the segment already exists, since it may
+// belong to another live writer. Set replace_existing to unlink it
+// first, e.g. after a crashed run left it behind.
+class SharedFrameWriter {
+public:
+    static constexpr int MAX_SLOTS = 16;
+
+    SharedFrameWriter(
+        const std::string& name,
+        const int width,
+        const int height,
+        const int slots = 3,
+        const bool replace_existing = false
+    );
+    ~SharedFrameWriter();
+
+    SharedFrameWriter(const SharedFrameWriter&) = delete;
+    SharedFrameWriter& operator=(const SharedFrameWriter&) = delete;
+
+    // Returns the next slot's pixels to draw into directly;
+    // readers ignore it until end_frame() publishes it.
+    std::uint32_t* begin_frame();
+    void end_frame();
+
+    // Copies a whole frame into the next slot and publishes it
+    void publish(const std::vector<std::uint32_t>& pixels);
+
+    std::uint64_t frames_published() const;
+
+private:
+    std::string name;
+    void* mapping;
+    std::size_t mapping_size;
+    SharedFrameHeader* header;
+    std::uint32_t* frames;
+    int slot;
+    bool writing;
+};
+
+// Attaches to a segment created by SharedFrameWriter.
+// acquire() hands out a pointer straight into the shared slot, with no
+// copy; release() then tells whether the writer reused the slot while
+// it was being read, in which case whatever was read may be torn and
+// must be discarded.
+class SharedFrameReader {
+public:
+    struct Frame {
+        const std::uint32_t* pixels;
+        std::uint64_t number;
+        int slot;
+        std::uint32_t sequence;
+    };
+
+    explicit SharedFrameReader(const std::string& name);
+    ~SharedFrameReader();
+
+    SharedFrameReader(const SharedFrameReader&) = delete;
+    SharedFrameReader& operator=(const SharedFrameReader&) = delete;
+
+    int width() const;
+    int height() const;
+
+    // Blocks until a frame newer than the last acquired one is published.
+    // Returns false if none arrives within timeout_ms.
+    bool wait_for_frame(const int timeout_ms);
+
+    // The most recently published frame. pixels is null if no frame
+    // has been published yet or the writer is already overwriting it.
+    Frame acquire();
+    bool release(const Frame& frame) const;
+
+    // Copies the most recently published frame, retrying if it is torn.
+    // Returns false if no frame has been published yet.
+    bool read(std::vector<std::uint32_t>& pixels, std::uint64_t* number = nullptr);
+
+private:
+    void* mapping;
+    std::size_t mapping_size;
+    const SharedFrameHeader* header;
+    const std::uint32_t* frames;
+    std::uint64_t last_number;
+};
+
+#endif
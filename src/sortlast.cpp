@@ -0,0 +1,311 @@
+#include "sortlast.hpp"
+#include "constants.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+constexpr std::size_t SORT_LAST_PAGE = 4096;
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "the barrier needs lock-free atomics");
+
+// Lives in the first page of the shared mapping
+struct SortLastRenderer::Control {
+    // Sense-reversing barrier shared by all workers
+    std::atomic<std::uint32_t> arrived;
+    std::atomic<std::uint32_t> generation;
+    // Bumped by the parent to start a frame; workers sleep on it
+    std::atomic<std::uint32_t> frame;
+    // Workers that have finished the current frame; the parent sleeps on it
+    std::atomic<std::uint32_t> done;
+    // Set before the last frame bump to make the workers exit
+    std::atomic<std::uint32_t> quit;
+};
+
+static void futex_wake_all(std::atomic<std::uint32_t>* word)
+{
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+// Sleeps while *word == expected, for at most timeout_ms
+static void futex_wait(const std::atomic<std::uint32_t>* word, const std::uint32_t expected, const int timeout_ms)
+{
+#if defined(__linux__)
+    timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+    syscall(SYS_futex, reinterpret_cast<const std::uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+#else
+    // No cross-process futex: poll instead
+    (void)word;
+    (void)expected;
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout_ms, 1)));
+#endif
+}
+
+// Pixel range [first, last) worker owns after the binary swap
+static void binary_swap_region(const int worker, const int workers, const std::size_t count, std::size_t& first, std::size_t& last)
+{
+    first = 0;
+    last = count;
+    for (int bit = 1; bit < workers; bit <<= 1) {
+        const std::size_t mid = first + (last - first) / 2;
+        if (worker & bit) {
+            first = mid;
+        } else {
+            last = mid;
+        }
+    }
+}
+
+SortLastRenderer::SortLastRenderer(const int workers, const int width, const int height, RenderFunc render_share)
+    : num_workers(workers), width(width), height(height), render_share(std::move(render_share)),
+      mapping(MAP_FAILED), mapping_size(0), control(nullptr), colors(nullptr), depths(nullptr), failed(false)
+{
+    if (workers < 1 || (workers & (workers - 1)) != 0) {
+        throw std::runtime_error("SortLastRenderer: the number of workers must be a power of two");
+    }
+    if (width <= 0 || height <= 0) {
+        throw std::runtime_error("SortLastRenderer: invalid frame size");
+    }
+
+    const std::size_t count = static_cast<std::size_t>(width) * height;
+    mapping_size = SORT_LAST_PAGE + workers * count * (sizeof(std::uint32_t) + sizeof(float));
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error(std::string("SortLastRenderer: can't map buffers: ") + std::strerror(errno));
+    }
+    control = new (mapping) Control();
+    colors = reinterpret_cast<std::uint32_t*>(static_cast<char*>(mapping) + SORT_LAST_PAGE);
+    depths = reinterpret_cast<float*>(colors + workers * count);
+
+    // Workers are forked once and then wait for frames, so each frame
+    // only pays for waking them rather than for creating processes
+    for (int w = 0; w < num_workers; w++) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            worker_loop(w);
+        }
+        if (pid < 0) {
+            const std::runtime_error error(std::string("SortLastRenderer: fork failed: ") + std::strerror(errno));
+            stop_workers(true);
+            munmap(mapping, mapping_size);
+            throw error;
+        }
+        children.push_back(pid);
+    }
+}
+
+SortLastRenderer::~SortLastRenderer()
+{
+    stop_workers(failed);
+    munmap(mapping, mapping_size);
+}
+
+int SortLastRenderer::workers() const
+{
+    return num_workers;
+}
+
+void SortLastRenderer::render(std::vector<std::uint32_t>& pixels)
+{
+    if (failed) {
+        throw std::runtime_error("SortLastRenderer: a worker process failed");
+    }
+
+    const std::size_t count = static_cast<std::size_t>(width) * height;
+    control->arrived.store(0, std::memory_order_relaxed);
+    control->done.store(0, std::memory_order_relaxed);
+    control->frame.fetch_add(1, std::memory_order_release);
+    futex_wake_all(&control->frame);
+
+    // The others would wait at the barrier forever if one worker died,
+    // so while waiting, the workers are checked now and then, and a
+    // single failure stops them all. Only this renderer's workers are
+    // waited for, so other children of the process are left alone.
+    for (;;) {
+        const std::uint32_t done = control->done.load(std::memory_order_acquire);
+        if (done == static_cast<std::uint32_t>(num_workers)) {
+            break;
+        }
+        futex_wait(&control->done, done, 10);
+        for (const pid_t child : children) {
+            int status = 0;
+            if (waitpid(child, &status, WNOHANG) != 0) {
+                failed = true;
+            }
+        }
+        if (failed) {
+            stop_workers(true);
+            throw std::runtime_error("SortLastRenderer: a worker process failed");
+        }
+    }
+
+    pixels.resize(count);
+    for (int w = 0; w < num_workers; w++) {
+        std::size_t first;
+        std::size_t last;
+        binary_swap_region(w, num_workers, count, first, last);
+        std::memcpy(pixels.data() + first, colors + w * count + first, (last - first) * sizeof(std::uint32_t));
+    }
+}
+
+// Asks the workers to exit and reaps them; with force, they are killed
+// instead, e.g. because one died and the others may be stuck waiting
+void SortLastRenderer::stop_workers(const bool force)
+{
+    if (force) {
+        for (const pid_t child : children) {
+            kill(child, SIGKILL);
+        }
+    } else {
+        control->quit.store(1, std::memory_order_relaxed);
+        control->frame.fetch_add(1, std::memory_order_release);
+        futex_wake_all(&control->frame);
+    }
+    for (const pid_t child : children) {
+        waitpid(child, nullptr, 0);
+    }
+    children.clear();
+}
+
+// Runs in each worker process and never returns
+void SortLastRenderer::worker_loop(const int worker)
+{
+    const pid_t parent = getppid();
+    // The counter was 0 when this worker was forked. Reading it here
+    // instead could miss a frame the parent started before the worker
+    // first ran, leaving the other workers stuck at the barrier.
+    std::uint32_t seen = 0;
+    for (;;) {
+        const std::uint32_t frame = control->frame.load(std::memory_order_acquire);
+        if (frame == seen) {
+            futex_wait(&control->frame, frame, 100);
+            // Don't linger if the parent went away without stopping us
+            if (getppid() != parent) {
+                _exit(1);
+            }
+            continue;
+        }
+        seen = frame;
+        if (control->quit.load(std::memory_order_relaxed) != 0) {
+            break;
+        }
+        try {
+            run_worker(worker);
+        } catch (...) {
+            _exit(1);
+        }
+        if (control->done.fetch_add(1, std::memory_order_acq_rel) + 1 == static_cast<std::uint32_t>(num_workers)) {
+            futex_wake_all(&control->done);
+        }
+    }
+    // Skip the parent's atexit handlers and static destructors
+    _exit(0);
+}
+
+void SortLastRenderer::run_worker(const int worker)
+{
+    const std::size_t count = static_cast<std::size_t>(width) * height;
+    std::uint32_t* color = colors + worker * count;
+    float* depth = depths + worker * count;
+    std::fill(color, color + count, COLOR_BLANK.raw);
+    std::fill(depth, depth + count, std::numeric_limits<float>::infinity());
+    render_share(worker, color, depth);
+
+    std::size_t first = 0;
+    std::size_t last = count;
+    for (int bit = 1; bit < num_workers; bit <<= 1) {
+        // The partner must have finished the previous round before
+        // its half of the region is read. Each worker only writes the
+        // half it keeps, so the halves being read are stable.
+        barrier();
+        const std::size_t mid = first + (last - first) / 2;
+        if (worker & bit) {
+            first = mid;
+        } else {
+            last = mid;
+        }
+        const int partner = worker ^ bit;
+        composite_depth(
+            color + first,
+            depth + first,
+            colors + partner * count + first,
+            depths + partner * count + first,
+            last - first,
+            partner < worker
+        );
+    }
+}
+
+void SortLastRenderer::barrier()
+{
+    const std::uint32_t generation = control->generation.load(std::memory_order_acquire);
+    if (control->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == static_cast<std::uint32_t>(num_workers)) {
+        control->arrived.store(0, std::memory_order_relaxed);
+        control->generation.fetch_add(1, std::memory_order_release);
+        return;
+    }
+    while (control->generation.load(std::memory_order_acquire) == generation) {
+        std::this_thread::yield();
+    }
+}
+
+void composite_depth(
+    std::uint32_t* dst_color,
+    float* dst_depth,
+    const std::uint32_t* src_color,
+    const float* src_depth,
+    const std::size_t count,
+    const bool src_wins_ties
+) {
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    // Four pixels at a time: select src where it is nearer
+    const __m128 ties = _mm_castsi128_ps(_mm_set1_epi32(src_wins_ties ? -1 : 0));
+    for (; i + 4 <= count; i += 4) {
+        const __m128 dz = _mm_loadu_ps(dst_depth + i);
+        const __m128 sz = _mm_loadu_ps(src_depth + i);
+        const __m128 take = _mm_or_ps(_mm_cmplt_ps(sz, dz), _mm_and_ps(_mm_cmpeq_ps(sz, dz), ties));
+        const __m128i mask = _mm_castps_si128(take);
+        const __m128i dc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst_color + i));
+        const __m128i sc = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_color + i));
+        _mm_storeu_ps(dst_depth + i, _mm_or_ps(_mm_and_ps(take, sz), _mm_andnot_ps(take, dz)));
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(dst_color + i),
+            _mm_or_si128(_mm_and_si128(mask, sc), _mm_andnot_si128(mask, dc))
+        );
+    }
+#endif
+    for (; i < count; i++) {
+        if (src_depth[i] < dst_depth[i] || (src_wins_ties && src_depth[i] == dst_depth[i])) {
+            dst_depth[i] = src_depth[i];
+            dst_color[i] = src_color[i];
+        }
+    }
+}
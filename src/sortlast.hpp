@@ -0,0 +1,77 @@
+#ifndef SORTLAST_H
+#define SORTLAST_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <sys/types.h>
+
+// Sort-last rendering across processes. The constructor forks one
+// worker process per share of the scene, and the workers stay alive
+// until the renderer is destroyed. Each render() starts a frame through
+// the shared-memory control page: every worker draws its share into its
+// own color and depth buffers, which live in the same shared mapping,
+// and the buffers are then merged by per-pixel depth with binary-swap
+// compositing: in each of log2(workers) rounds, partners split the
+// region they are responsible for in half, and each merges the other's
+// pixels into the half it keeps. The parent finally gathers every
+// worker's fully merged region.
+//
+// Workers inherit the scene through fork(), so nothing is serialized,
+// but they only see the parent's memory as it was when the renderer was
+// constructed. Where depths are equal, the lower-numbered worker wins,
+// so giving worker i the i-th contiguous slice of a scene matches
+// rendering the whole scene in one SpanBuffer.
+class SortLastRenderer {
+public:
+    // Called in each worker process once per frame. color and depth are
+    // width * height buffers, cleared to COLOR_BLANK and infinity;
+    // smaller z is nearer.
+    using RenderFunc = std::function<void(const int worker, std::uint32_t* color, float* depth)>;
+
+    // workers must be a power of two
+    SortLastRenderer(const int workers, const int width, const int height, RenderFunc render_share);
+    ~SortLastRenderer();
+
+    SortLastRenderer(const SortLastRenderer&) = delete;
+    SortLastRenderer& operator=(const SortLastRenderer&) = delete;
+
+    // Throws if a worker has died; the renderer can't be used after that
+    void render(std::vector<std::uint32_t>& pixels);
+
+    int workers() const;
+
+private:
+    struct Control;
+
+    int num_workers;
+    int width;
+    int height;
+    RenderFunc render_share;
+    void* mapping;
+    std::size_t mapping_size;
+    Control* control;
+    std::uint32_t* colors;
+    float* depths;
+    std::vector<pid_t> children;
+    bool failed;
+
+    void worker_loop(const int worker);
+    void run_worker(const int worker);
+    void barrier();
+    void stop_workers(const bool force);
+};
+
+// Where color/depth from src is nearer than dst, or equally near and
+// src_wins_ties is set, copies it over dst
+void composite_depth(
+    std::uint32_t* dst_color,
+    float* dst_depth,
+    const std::uint32_t* src_color,
+    const float* src_depth,
+    const std::size_t count,
+    const bool src_wins_ties
+);
+
+#endif
@@ -0,0 +1,142 @@
+#include "spanbuffer.hpp"
+#include <algorithm>
+
+SpanBuffer::SpanBuffer(const int width, const int height)
+    : width(width), height(height), rows(height)
+{
+}
+
+void SpanBuffer::clear()
+{
+    for (std::vector<Span>& row : rows) {
+        row.clear();
+    }
+}
+
+void SpanBuffer::insert(const int y, int x0, int x1, const float z, const std::uint32_t color)
+{
+    if (y < 0 || y >= height) {
+        return;
+    }
+    if (x0 > x1) {
+        std::swap(x0, x1);
+    }
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, width - 1);
+    if (x0 > x1) {
+        return;
+    }
+
+    std::vector<Span>& row = rows[y];
+
+    // Only the spans overlapping [x0, x1] can change, so binary-search
+    // for them and rebuild just that range.
+    const auto first = std::partition_point(row.begin(), row.end(), [x0](const Span& s) {
+        return s.x1 < x0;
+    });
+    auto last = first;
+    while (last != row.end() && last->x0 <= x1) {
+        ++last;
+    }
+    if (first == last) {
+        row.insert(first, {x0, x1, z, color});
+        return;
+    }
+
+    // Walk the overlapped spans from left to right.
+    // "cur" is the leftmost x of the new span that has not been
+    // emitted or hidden yet. Visible pieces of the new span are
+    // emitted lazily so that a run which swallows several farther
+    // spans stays a single span.
+    scratch.clear();
+    bool changed = false;
+    int cur = x0;
+    for (auto it = first; it != last; ++it) {
+        const Span& s = *it;
+        if (s.z <= z) {
+            // The existing span is nearer (ties keep the first writer)
+            if (cur < s.x0) {
+                scratch.push_back({cur, s.x0 - 1, z, color});
+                changed = true;
+            }
+            scratch.push_back(s);
+            cur = std::max(cur, s.x1 + 1);
+        } else {
+            // The new span is nearer; keep whatever sticks out of it
+            changed = true;
+            if (s.x0 < x0) {
+                scratch.push_back({s.x0, x0 - 1, s.z, s.color});
+            }
+            if (s.x1 > x1) {
+                if (cur <= x1) {
+                    scratch.push_back({cur, x1, z, color});
+                    cur = x1 + 1;
+                }
+                scratch.push_back({x1 + 1, s.x1, s.z, s.color});
+            }
+        }
+    }
+    if (cur <= x1) {
+        scratch.push_back({cur, x1, z, color});
+        changed = true;
+    }
+    if (!changed) {
+        // Entirely hidden behind nearer spans
+        return;
+    }
+
+    // Splice the rebuilt range over the old one, overwriting in place
+    // and only shifting the tail of the row when the span count changes
+    const std::size_t old_count = static_cast<std::size_t>(last - first);
+    const std::size_t begin = static_cast<std::size_t>(first - row.begin());
+    const std::size_t common = std::min(old_count, scratch.size());
+    std::copy(scratch.begin(), scratch.begin() + common, row.begin() + begin);
+    if (scratch.size() > old_count) {
+        row.insert(row.begin() + begin + common, scratch.begin() + common, scratch.end());
+    } else if (scratch.size() < old_count) {
+        row.erase(row.begin() + begin + common, row.begin() + begin + old_count);
+    }
+}
+
+void SpanBuffer::resolve(std::vector<std::uint32_t>& pixels) const
+{
+    std::uint32_t* row_ptr = pixels.data();
+    for (const std::vector<Span>& row : rows) {
+        for (const Span& s : row) {
+            std::fill(row_ptr + s.x0, row_ptr + s.x1 + 1, s.color);
+        }
+        row_ptr += width;
+    }
+}
+
+void SpanBuffer::resolve(std::uint32_t* pixels, float* depth) const
+{
+    for (const std::vector<Span>& row : rows) {
+        for (const Span& s : row) {
+            std::fill(pixels + s.x0, pixels + s.x1 + 1, s.color);
+            std::fill(depth + s.x0, depth + s.x1 + 1, s.z);
+        }
+        pixels += width;
+        depth += width;
+    }
+}
+
+std::size_t SpanBuffer::span_count() const
+{
+    std::size_t count = 0;
+    for (const std::vector<Span>& row : rows) {
+        count += row.size();
+    }
+    return count;
+}
+
+std::size_t SpanBuffer::pixel_count() const
+{
+    std::size_t count = 0;
+    for (const std::vector<Span>& row : rows) {
+        for (const Span& s : row) {
+            count += s.x1 - s.x0 + 1;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,51 @@
+#ifndef SPANBUFFER_H
+#define SPANBUFFER_H
+
+#include "framebuffer.hpp"
+#include <vector>
+#include <cstdint>
+
+// S-buffer: each scanline keeps a sorted list of non-overlapping,
+// depth-tagged spans. Inserting a span clips it against the spans
+// already on that scanline, so after all opaque geometry has been
+// inserted, resolve() writes every covered pixel exactly once.
+class SpanBuffer {
+public:
+    SpanBuffer(const int width, const int height);
+
+    void clear();
+    void insert(const int y, int x0, int x1, const float z, const std::uint32_t color);
+    void resolve(std::vector<std::uint32_t>& pixels) const;
+    // Also writes each covered pixel's z; uncovered pixels are left alone
+    void resolve(std::uint32_t* pixels, float* depth) const;
+    std::size_t span_count() const;
+    // Number of pixels resolve() writes
+    std::size_t pixel_count() const;
+
+    template <typename Format>
+    void resolve(Framebuffer<Format>& fb) const
+    {
+        for (int y = 0; y < height; y++) {
+            for (const Span& s : rows[y]) {
+                fb.fill_span(y, s.x0, s.x1, s.color);
+            }
+        }
+    }
+
+private:
+    // x0 and x1 are both inclusive.
+    // Smaller z is nearer to the camera.
+    struct Span {
+        int x0;
+        int x1;
+        float z;
+        std::uint32_t color;
+    };
+
+    int width;
+    int height;
+    std::vector<std::vector<Span>> rows;
+    std::vector<Span> scratch;
+};
+
+#endif
@@ -4,7 +4,11 @@
 #include "utils.hpp"
 #include <cassert>
 #include <cmath>
-#include <functional>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 void draw_filled_triangle(
     std::vector<std::uint32_t>& pixels,
@@ -172,14 +176,28 @@ void draw_triangle_outline_3d(
 }
 
 
-void draw_filled_triangle_flat_side(
-    std::vector<std::uint32_t>& pixels,
-    const unsigned int width,
-    const std::uint32_t color,
-    SDL_Point v0,
-    SDL_Point v1,
-    SDL_Point v2
-) {
+// Emits rows y through y_end (inclusive) between two edges,
+// stepping each edge to the next scanline after every row.
+template <typename LeftEdge, typename RightEdge, typename EmitRow>
+void walk_edges(LeftEdge l, RightEdge r, int y, const int y_end, EmitRow& emit_row)
+{
+    for (;;) {
+        emit_row(y, l.x, r.x);
+        if (y == y_end) {
+            break;
+        }
+        y++;
+        l.next_row();
+        r.next_row();
+    }
+}
+
+
+// Walks both edges of a triangle with one horizontal side
+// and hands each scanline's inclusive x extent to emit_row.
+template <typename EmitRow>
+void walk_flat_side(SDL_Point v0, SDL_Point v1, SDL_Point v2, EmitRow&& emit_row)
+{
     assert(v1.y == v2.y);
     if (v1.x > v2.x) {
         std::swap(v1, v2);
@@ -189,7 +207,6 @@ void draw_filled_triangle_flat_side(
     int y10;
     int x10_end;
     int x20;
-    int y20;
     int x20_end;
     int y_end;
     if (v0.y < v1.y) {
@@ -199,7 +216,6 @@ void draw_filled_triangle_flat_side(
         y10 = v0.y;
         x10_end = v1.x;
         x20 = v0.x;
-        y20 = v0.y;
         x20_end = v2.x;
         y_end = v1.y;
     } else {
@@ -209,80 +225,274 @@ void draw_filled_triangle_flat_side(
         y10 = v1.y;
         x10_end = v0.x;
         x20 = v2.x;
-        y20 = v2.y;
         x20_end = v0.x;
         y_end = v0.y;
     }
 
-    int s10 = x10 < x10_end ? 1 : -1;
-    int e10_same;
-    int e10_diff;
-    int p10;
-    std::function<void(int&, int&, int&, int&, int&, int&)> inc_func_l10;
+    // Instantiate the row walk for each gentle/steep combination
     const int dx10 = std::abs(v0.x - v1.x);
     const int dy10 = std::abs(v0.y - v1.y);
-    if (dx10 > dy10) {
-        // Gentle slope; x always incremented
-        e10_same = 2 * dy10;
-        e10_diff = 2 * (dy10 - dx10);
-        p10 = e10_same - dx10;
-        inc_func_l10 = inc_bresenham_gentle;
-    } else {
-        // Steep slope; y always incremented
-        e10_same = 2 * dx10;
-        e10_diff = 2 * (dx10 - dy10);
-        p10 = e10_same - dy10;
-        inc_func_l10 = inc_bresenham_steep;
-    }
-
-    int s20 = x20 < x20_end ? 1 : -1;
-    int e20_same;
-    int e20_diff;
-    int p20;
-    std::function<void(int&, int&, int&, int&, int&, int&)> inc_func_l20;
     const int dx20 = std::abs(v0.x - v2.x);
     const int dy20 = std::abs(v0.y - v2.y);
-    if (dx20 > dy20) {
-        // Gentle slope; x always incremented
-        e20_same = 2 * dy20;
-        e20_diff = 2 * (dy20 - dx20);
-        p20 = e20_same - dx20;
-        inc_func_l20 = inc_bresenham_gentle;
+    if (dx10 > dy10) {
+        const BresenhamGentleEdge l10(x10, x10_end, dx10, dy10);
+        if (dx20 > dy20) {
+            walk_edges(l10, BresenhamGentleEdge(x20, x20_end, dx20, dy20), y10, y_end, emit_row);
+        } else {
+            walk_edges(l10, BresenhamSteepEdge(x20, x20_end, dx20, dy20), y10, y_end, emit_row);
+        }
     } else {
-        // Steep slope; y always incremented
-        e20_same = 2 * dx20;
-        e20_diff = 2 * (dx20 - dy20);
-        p20 = e20_same - dy20;
-        inc_func_l20 = inc_bresenham_steep;
-    }
-
-    const int row_end = y_end * width;
-    for (int row = y10 * width; row <= row_end; row += width) {
-        // Draw row
-        for (int x = x10; x <= x20; x++) {
-            pixels.at(row + x) = color;
+        const BresenhamSteepEdge l10(x10, x10_end, dx10, dy10);
+        if (dx20 > dy20) {
+            walk_edges(l10, BresenhamGentleEdge(x20, x20_end, dx20, dy20), y10, y_end, emit_row);
+        } else {
+            walk_edges(l10, BresenhamSteepEdge(x20, x20_end, dx20, dy20), y10, y_end, emit_row);
         }
+    }
+}
 
-        // Increment both lines
-        const int y_old = y10;
-        while (y10 == y_old) {
-            inc_func_l10(x10, y10, s10, p10, e10_same, e10_diff);
-        }
-        while (y20 == y_old) {
-            inc_func_l20(x20, y20, s20, p20, e20_same, e20_diff);
+
+// Triangles whose bounding box fits in SMALL_TRIANGLE_SIZE x SMALL_TRIANGLE_SIZE
+// pixels skip the Bresenham edge setup and are rasterized by testing
+// every pixel of the box, SMALL_TRIANGLE_SIZE pixels per SIMD pass.
+constexpr int SMALL_TRIANGLE_SIZE = 8;
+
+struct Bounds {
+    int min_x;
+    int max_x;
+    int min_y;
+    int max_y;
+};
+
+static Bounds triangle_bounds(const SDL_Point& v0, const SDL_Point& v1, const SDL_Point& v2)
+{
+    return {
+        std::min({v0.x, v1.x, v2.x}),
+        std::max({v0.x, v1.x, v2.x}),
+        std::min({v0.y, v1.y, v2.y}),
+        std::max({v0.y, v1.y, v2.y})
+    };
+}
+
+static bool is_small_triangle(const Bounds& b)
+{
+    return b.max_x - b.min_x < SMALL_TRIANGLE_SIZE && b.max_y - b.min_y < SMALL_TRIANGLE_SIZE;
+}
+
+
+// Edge functions for a small triangle, relative to its bounding box.
+// For edge a -> b, E(x, y) = A * (x - a.x) + B * (y - a.y), flipped for
+// clockwise triangles so that it is positive inside. 2 * E is biased by
+// max(|A|, |B|): like the Bresenham walk, a pixel on the minor-axis side
+// of an edge is covered if it is within half a pixel of the edge.
+// Every term is small, so 16-bit SIMD lanes are enough.
+struct SmallTriangleEdges {
+    int row_start[3];
+    int step_x[3];
+    int step_y[3];
+
+    SmallTriangleEdges(const SDL_Point& v0, const SDL_Point& v1, const SDL_Point& v2, const Bounds& b)
+    {
+        const int area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        const int sign = area < 0 ? -1 : 1;
+        const SDL_Point* edges[3][2] = {{&v0, &v1}, {&v1, &v2}, {&v2, &v0}};
+        for (int i = 0; i < 3; i++) {
+            const SDL_Point& p = *edges[i][0];
+            const SDL_Point& q = *edges[i][1];
+            const int A = sign * (p.y - q.y);
+            const int B = sign * (q.x - p.x);
+            row_start[i] = 2 * (A * (b.min_x - p.x) + B * (b.min_y - p.y)) + std::max(std::abs(A), std::abs(B));
+            step_x[i] = 2 * A;
+            step_y[i] = 2 * B;
         }
     }
+};
+
+
+#if defined(__SSE2__)
+// Coverage of each row of the bounding box, one 16-bit lane per pixel
+static void small_triangle_masks(const SmallTriangleEdges& edges, const Bounds& b, __m128i* masks)
+{
+    const __m128i lanes = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m128i neg_one = _mm_set1_epi16(-1);
+    __m128i e[3];
+    __m128i e_step[3];
+    for (int i = 0; i < 3; i++) {
+        e[i] = _mm_add_epi16(
+            _mm_set1_epi16(static_cast<short>(edges.row_start[i])),
+            _mm_mullo_epi16(_mm_set1_epi16(static_cast<short>(edges.step_x[i])), lanes)
+        );
+        e_step[i] = _mm_set1_epi16(static_cast<short>(edges.step_y[i]));
+    }
+    for (int y = b.min_y; y <= b.max_y; y++) {
+        masks[y - b.min_y] = _mm_and_si128(
+            _mm_and_si128(_mm_cmpgt_epi16(e[0], neg_one), _mm_cmpgt_epi16(e[1], neg_one)),
+            _mm_cmpgt_epi16(e[2], neg_one)
+        );
+        e[0] = _mm_add_epi16(e[0], e_step[0]);
+        e[1] = _mm_add_epi16(e[1], e_step[1]);
+        e[2] = _mm_add_epi16(e[2], e_step[2]);
+    }
 }
 
 
-void draw_filled_triangle_bres(
+// Writes a small triangle straight into an ARGB8888 buffer with one
+// masked store per half row. The whole SMALL_TRIANGLE_SIZE-wide box is
+// read and written back, so it must lie inside the row.
+static void fill_small_triangle(
     std::vector<std::uint32_t>& pixels,
     const unsigned int width,
     const std::uint32_t color,
-    SDL_Point v0,
-    SDL_Point v1,
-    SDL_Point v2
+    const SDL_Point& v0,
+    const SDL_Point& v1,
+    const SDL_Point& v2,
+    const Bounds& b
 ) {
+    __m128i masks[SMALL_TRIANGLE_SIZE];
+    small_triangle_masks(SmallTriangleEdges(v0, v1, v2, b), b, masks);
+
+    const __m128i c = _mm_set1_epi32(static_cast<int>(color));
+    std::uint32_t* row = pixels.data() + b.min_y * width + b.min_x;
+    for (int i = 0; i <= b.max_y - b.min_y; i++, row += width) {
+        // Widen the 16-bit lane masks to one 32-bit mask per pixel
+        const __m128i lo = _mm_unpacklo_epi16(masks[i], masks[i]);
+        const __m128i hi = _mm_unpackhi_epi16(masks[i], masks[i]);
+        __m128i* dst = reinterpret_cast<__m128i*>(row);
+        const __m128i d0 = _mm_loadu_si128(dst);
+        const __m128i d1 = _mm_loadu_si128(dst + 1);
+        _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(lo, c), _mm_andnot_si128(lo, d0)));
+        _mm_storeu_si128(dst + 1, _mm_or_si128(_mm_and_si128(hi, c), _mm_andnot_si128(hi, d1)));
+    }
+}
+#endif
+
+
+// Emits the covered extent of each row of a small triangle
+template <typename EmitRow>
+void walk_small_triangle(
+    const SDL_Point& v0,
+    const SDL_Point& v1,
+    const SDL_Point& v2,
+    const Bounds& b,
+    EmitRow& emit_row
+) {
+    const SmallTriangleEdges edges(v0, v1, v2, b);
+#if defined(__SSE2__)
+    __m128i masks[SMALL_TRIANGLE_SIZE];
+    small_triangle_masks(edges, b, masks);
+    for (int y = b.min_y; y <= b.max_y; y++) {
+        // Two mask bits per 16-bit lane
+        const unsigned int mask = _mm_movemask_epi8(masks[y - b.min_y]);
+        if (mask != 0) {
+            emit_row(y, b.min_x + __builtin_ctz(mask) / 2, b.min_x + (31 - __builtin_clz(mask)) / 2);
+        }
+    }
+#else
+    for (int y = b.min_y; y <= b.max_y; y++) {
+        const int row = y - b.min_y;
+        unsigned int mask = 0;
+        for (int lane = 0; lane < SMALL_TRIANGLE_SIZE; lane++) {
+            bool inside = true;
+            for (int i = 0; i < 3; i++) {
+                const int e = edges.row_start[i] + lane * edges.step_x[i] + row * edges.step_y[i];
+                inside = inside && e >= 0;
+            }
+            mask |= static_cast<unsigned int>(inside) << lane;
+        }
+        if (mask != 0) {
+            emit_row(y, b.min_x + __builtin_ctz(mask), b.min_x + 31 - __builtin_clz(mask));
+        }
+    }
+#endif
+}
+
+
+static bool is_zero_area(const SDL_Point& v0, const SDL_Point& v1, const SDL_Point& v2)
+{
+    return (v1.x - v0.x) * (v2.y - v0.y) == (v1.y - v0.y) * (v2.x - v0.x);
+}
+
+
+#if defined(__SSE2__)
+// Whether draw_filled_triangle_bres() uses fill_small_triangle(), which
+// needs the whole SMALL_TRIANGLE_SIZE-wide box inside the buffer
+static bool uses_small_fill(
+    const SDL_Point& v0,
+    const SDL_Point& v1,
+    const SDL_Point& v2,
+    const Bounds& b,
+    const int width,
+    const int height
+) {
+    return b.min_y != b.max_y && is_small_triangle(b) && !is_zero_area(v0, v1, v2)
+        && b.min_x >= 0 && b.min_x + SMALL_TRIANGLE_SIZE <= width
+        && b.min_y >= 0 && b.max_y < height;
+}
+#endif
+
+
+// A zero-area triangle that isn't horizontal is the line segment from
+// its topmost to its bottommost vertex. Each row's run of that segment
+// is emitted directly instead of walking two coincident edges, which
+// for gentle slopes would only emit one pixel per row.
+template <typename EmitRow>
+void walk_degenerate_triangle(const SDL_Point& top, const SDL_Point& bottom, EmitRow& emit_row)
+{
+    const int dx = std::abs(bottom.x - top.x);
+    const int dy = bottom.y - top.y;
+    if (dx > dy) {
+        BresenhamGentleEdge edge(top.x, bottom.x, dx, dy);
+        for (int y = top.y; y < bottom.y; y++) {
+            const int x_first = edge.x;
+            edge.next_row();
+            const int x_last = edge.x - edge.step;
+            emit_row(y, std::min(x_first, x_last), std::max(x_first, x_last));
+        }
+        emit_row(bottom.y, std::min(edge.x, bottom.x), std::max(edge.x, bottom.x));
+    } else {
+        BresenhamSteepEdge edge(top.x, bottom.x, dx, dy);
+        for (int y = top.y;; y++) {
+            emit_row(y, edge.x, edge.x);
+            if (y == bottom.y) {
+                break;
+            }
+            edge.next_row();
+        }
+    }
+}
+
+
+// Sorts the vertices, splits the triangle into flat-sided halves
+// if necessary, and hands every scanline's x extent to emit_row.
+// Small, zero-height and zero-area triangles take shortcuts instead.
+template <typename EmitRow>
+void walk_triangle(SDL_Point v0, SDL_Point v1, SDL_Point v2, EmitRow&& emit_row)
+{
+    const Bounds b = triangle_bounds(v0, v1, v2);
+    if (b.min_y == b.max_y) {
+        // Zero height: the whole triangle is one run
+        emit_row(b.min_y, b.min_x, b.max_x);
+        return;
+    }
+    if (is_zero_area(v0, v1, v2)) {
+        const SDL_Point* top = &v0;
+        const SDL_Point* bottom = &v0;
+        for (const SDL_Point* v : {&v1, &v2}) {
+            if (v->y < top->y) {
+                top = v;
+            }
+            if (v->y > bottom->y) {
+                bottom = v;
+            }
+        }
+        walk_degenerate_triangle(*top, *bottom, emit_row);
+        return;
+    }
+    if (is_small_triangle(b)) {
+        walk_small_triangle(v0, v1, v2, b, emit_row);
+        return;
+    }
+
     // Sort points so that y0 <= y1 <= y2
     if (v1.y < v0.y) {
         std::swap(v1, v0);
@@ -296,12 +506,12 @@ void draw_filled_triangle_bres(
 
     if (v1.y == v2.y) {
         // Bottom is flat
-        draw_filled_triangle_flat_side(pixels, width, color, v0, v1, v2);
-    } else if (v0.y == v1.y) {	
+        walk_flat_side(v0, v1, v2, emit_row);
+    } else if (v0.y == v1.y) {
         // Top is flat
-        draw_filled_triangle_flat_side(pixels, width, color, v2, v0, v1);
+        walk_flat_side(v2, v0, v1, emit_row);
     } else {
-        // Split triangle in two.	
+        // Split triangle in two.
         // Note that y1 < y2, so the program needs to find
         // the x value where a horizontal line extending from p1
         // intersects the line between p0 and p2.
@@ -310,16 +520,208 @@ void draw_filled_triangle_bres(
         const int vmid_x = std::round((dxdy02 * static_cast<float>(y_diff)) + static_cast<float>(v0.x));
         SDL_Point vmid = {vmid_x, v1.y};
         if (v1.x < vmid_x) {
-            draw_filled_triangle_flat_side(pixels, width, color, v0, v1, vmid);
-            draw_filled_triangle_flat_side(pixels, width, color, v2, v1, vmid);
+            walk_flat_side(v0, v1, vmid, emit_row);
+            walk_flat_side(v2, v1, vmid, emit_row);
         } else {
-            draw_filled_triangle_flat_side(pixels, width, color, v0, vmid, v1);
-            draw_filled_triangle_flat_side(pixels, width, color, v2, vmid, v1);
+            walk_flat_side(v0, vmid, v1, emit_row);
+            walk_flat_side(v2, vmid, v1, emit_row);
         }
     }
 }
 
 
+// Clips the inclusive run [x_l, x_r] on row y to a width x height
+// buffer. Returns false if nothing of it is left.
+static bool clip_row(const int y, int& x_l, int& x_r, const int width, const int height)
+{
+    if (y < 0 || y >= height) {
+        return false;
+    }
+    x_l = std::max(x_l, 0);
+    x_r = std::min(x_r, width - 1);
+    return x_l <= x_r;
+}
+
+
+static void fill_row_clipped(
+    std::vector<std::uint32_t>& pixels,
+    const unsigned int width,
+    const std::uint32_t color,
+    const int y,
+    int x_l,
+    int x_r
+) {
+    const int height = static_cast<int>(pixels.size() / width);
+    if (!clip_row(y, x_l, x_r, static_cast<int>(width), height)) {
+        return;
+    }
+    std::uint32_t* row = pixels.data() + static_cast<std::size_t>(y) * width;
+    std::fill(row + x_l, row + x_r + 1, color);
+}
+
+
+void draw_filled_triangle_flat_side(
+    std::vector<std::uint32_t>& pixels,
+    const unsigned int width,
+    const std::uint32_t color,
+    SDL_Point v0,
+    SDL_Point v1,
+    SDL_Point v2
+) {
+    walk_flat_side(v0, v1, v2, [&](const int y, const int x_l, const int x_r) {
+        fill_row_clipped(pixels, width, color, y, x_l, x_r);
+    });
+}
+
+
+void draw_filled_triangle_bres(
+    std::vector<std::uint32_t>& pixels,
+    const unsigned int width,
+    const std::uint32_t color,
+    SDL_Point v0,
+    SDL_Point v1,
+    SDL_Point v2
+) {
+#if defined(__SSE2__)
+    const Bounds b = triangle_bounds(v0, v1, v2);
+    if (uses_small_fill(v0, v1, v2, b, static_cast<int>(width), static_cast<int>(pixels.size() / width))) {
+        fill_small_triangle(pixels, width, color, v0, v1, v2, b);
+        return;
+    }
+#endif
+    walk_triangle(v0, v1, v2, [&](const int y, const int x_l, const int x_r) {
+        fill_row_clipped(pixels, width, color, y, x_l, x_r);
+    });
+}
+
+
+template <typename Format>
+void draw_filled_triangle_bres(
+    Framebuffer<Format>& fb,
+    const std::uint32_t color,
+    SDL_Point v0,
+    SDL_Point v1,
+    SDL_Point v2
+) {
+    walk_triangle(v0, v1, v2, [&](const int y, int x_l, int x_r) {
+        if (clip_row(y, x_l, x_r, fb.width(), fb.height())) {
+            fb.fill_span(y, x_l, x_r, color);
+        }
+    });
+}
+
+template void draw_filled_triangle_bres(Framebuffer<FormatARGB8888>&, const std::uint32_t, SDL_Point, SDL_Point, SDL_Point);
+template void draw_filled_triangle_bres(Framebuffer<FormatRGB565>&, const std::uint32_t, SDL_Point, SDL_Point, SDL_Point);
+template void draw_filled_triangle_bres(Framebuffer<FormatRGB332>&, const std::uint32_t, SDL_Point, SDL_Point, SDL_Point);
+
+
+int count_filled_triangle_pixels(SDL_Point v0, SDL_Point v1, SDL_Point v2)
+{
+    int count = 0;
+    walk_triangle(v0, v1, v2, [&](const int, const int x_l, const int x_r) {
+        count += x_r - x_l + 1;
+    });
+    return count;
+}
+
+
+void draw_filled_triangle_spans(
+    SpanBuffer& spans,
+    const std::uint32_t color,
+    const float z,
+    SDL_Point v0,
+    SDL_Point v1,
+    SDL_Point v2
+) {
+    walk_triangle(v0, v1, v2, [&](const int y, const int x_l, const int x_r) {
+        spans.insert(y, x_l, x_r, z, color);
+    });
+}
+
+
+void draw_filled_triangle_overdraw(OverdrawMap& overdraw, SDL_Point v0, SDL_Point v1, SDL_Point v2)
+{
+#if defined(__SSE2__)
+    const Bounds b = triangle_bounds(v0, v1, v2);
+    if (uses_small_fill(v0, v1, v2, b, overdraw.width(), overdraw.height())) {
+        // fill_small_triangle() stores every pixel of each row of the box
+        for (int y = b.min_y; y <= b.max_y; y++) {
+            overdraw.add_span(y, b.min_x, b.min_x + SMALL_TRIANGLE_SIZE - 1);
+        }
+        return;
+    }
+#endif
+    walk_triangle(v0, v1, v2, [&](const int y, const int x_l, const int x_r) {
+        overdraw.add_span(y, x_l, x_r);
+    });
+}
+
+
+void draw_triangle_visibility(
+    VisibilityBuffer& vis,
+    const std::uint32_t id,
+    const Point3D& p0,
+    const Point3D& p1,
+    const Point3D& p2
+) {
+    const SDL_Point v0 = project_special(p0);
+    const SDL_Point v1 = project_special(p1);
+    const SDL_Point v2 = project_special(p2);
+    // -1/z is linear in screen space and, like z, smaller when nearer
+    const AttributePlane depth = attribute_plane(v0, v1, v2, -1.0f / p0.z, -1.0f / p1.z, -1.0f / p2.z);
+    walk_triangle(v0, v1, v2, [&](const int y, const int x_l, const int x_r) {
+        vis.insert(y, x_l, x_r, depth, id);
+    });
+}
+
+
+std::size_t shade_visibility_buffer(
+    std::vector<std::uint32_t>& pixels,
+    const unsigned int width,
+    const VisibilityBuffer& vis,
+    const std::vector<Triangle3D>& tris,
+    const std::vector<std::uint32_t>& colors
+) {
+    assert(colors.size() == tris.size());
+    assert(vis.width() <= static_cast<int>(width));
+
+    // Attributes are fetched per triangle, not per pixel
+    std::vector<AttributePlane> h_planes(tris.size());
+    for (std::size_t i = 0; i < tris.size(); i++) {
+        const Triangle3D& t = tris[i];
+        h_planes[i] = attribute_plane(
+            project_special(t.a), project_special(t.b), project_special(t.c), t.a.h, t.b.h, t.c.h
+        );
+    }
+
+    std::size_t shaded = 0;
+    const std::vector<std::uint32_t>& ids = vis.ids();
+    for (int y = 0; y < vis.height(); y++) {
+        int x0;
+        int x1;
+        if (!vis.row_extent(y, x0, x1)) {
+            continue;
+        }
+        const std::uint32_t* id_row = ids.data() + static_cast<std::size_t>(y) * vis.width();
+        std::uint32_t* row = pixels.data() + static_cast<std::size_t>(y) * width;
+        for (int x = x0; x <= x1; x++) {
+            const std::uint32_t id = id_row[x];
+            if (id == VisibilityBuffer::NO_TRIANGLE) {
+                continue;
+            }
+            const std::uint32_t color = colors[id];
+            const float h = std::clamp(h_planes[id].at(x, y), 0.0f, 1.0f);
+            const int pix_r = std::round(h * ((color >> 16) & 0xFF));
+            const int pix_g = std::round(h * ((color >> 8) & 0xFF));
+            const int pix_b = std::round(h * (color & 0xFF));
+            row[x] = (color & 0xFF000000) | (pix_r << 16) | (pix_g << 8) | pix_b;
+            shaded++;
+        }
+    }
+    return shaded;
+}
+
+
 void draw_filled_triangle_3d(
     std::vector<std::uint32_t>& pixels,
     const unsigned int width,
@@ -333,3 +735,19 @@ void draw_filled_triangle_3d(
     SDL_Point v2 = project_special(p2);
     draw_filled_triangle_bres(pixels, width, color, v0, v1, v2);
 }
+
+
+void draw_filled_triangle_3d_spans(
+    SpanBuffer& spans,
+    const std::uint32_t color,
+    const Point3D& p0,
+    const Point3D& p1,
+    const Point3D& p2
+) {
+    const SDL_Point v0 = project_special(p0);
+    const SDL_Point v1 = project_special(p1);
+    const SDL_Point v2 = project_special(p2);
+    // One depth for the whole triangle; see the note in triangle.hpp
+    const float z = (p0.z + p1.z + p2.z) / 3.0f;
+    draw_filled_triangle_spans(spans, color, z, v0, v1, v2);
+}
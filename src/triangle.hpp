@@ -2,8 +2,13 @@
 #define TRIANGLE_H
 
 #include "point.hpp"
+#include "spanbuffer.hpp"
+#include "overdraw.hpp"
+#include "visibility.hpp"
+#include "framebuffer.hpp"
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 #include <SDL2/SDL.h>
 
 struct Triangle2D {
@@ -52,6 +57,7 @@ void draw_triangle_outline_3d(
     const Point3D& p2
 );
 
+// Rows and columns outside the buffer are clipped away.
 void draw_filled_triangle_bres(
     std::vector<std::uint32_t>& pixels,
     const unsigned int width,
@@ -79,4 +85,79 @@ void draw_filled_triangle_3d(
     Point3D p2
 );
 
+// Same as above, but writes into a framebuffer of any pixel format.
+// Instantiated for FormatARGB8888, FormatRGB565 and FormatRGB332.
+template <typename Format>
+void draw_filled_triangle_bres(
+    Framebuffer<Format>& fb,
+    const std::uint32_t color,
+    SDL_Point v0,
+    SDL_Point v1,
+    SDL_Point v2
+);
+
+// Number of pixel writes draw_filled_triangle_bres() would make for a
+// triangle inside the buffer, counting the rows shared by split halves
+// twice. Triangles whose
+// bounding box is at most 8x8 pixels are not split: a SIMD kernel tests
+// the whole box at once and emits each row once.
+int count_filled_triangle_pixels(SDL_Point v0, SDL_Point v1, SDL_Point v2);
+
+// Span-buffer variants: instead of writing pixels, emit one span per
+// scanline tagged with the triangle's depth. Call SpanBuffer::resolve()
+// once all opaque geometry has been submitted.
+//
+// Each span carries a single depth; the 3D variant uses the average of
+// the vertices' z. Triangles that intersect, or overlap at a slant, are
+// therefore ordered as a whole and may resolve to the wrong span where
+// a per-pixel depth test would not. Use draw_triangle_visibility() when
+// that matters.
+void draw_filled_triangle_spans(
+    SpanBuffer& spans,
+    const std::uint32_t color,
+    const float z,
+    SDL_Point v0,
+    SDL_Point v1,
+    SDL_Point v2
+);
+
+void draw_filled_triangle_3d_spans(
+    SpanBuffer& spans,
+    const std::uint32_t color,
+    const Point3D& p0,
+    const Point3D& p1,
+    const Point3D& p2
+);
+
+// Debug variant: counts the writes draw_filled_triangle_bres() would
+// make to each pixel of a buffer the map's size, instead of writing
+// them. That includes rows shared by split halves and, for triangles
+// it fills with SIMD, the uncovered pixels of each stored row. Call
+// OverdrawMap::add_cost() afterwards to charge the triangle's cost to
+// the tiles it touched.
+void draw_filled_triangle_overdraw(OverdrawMap& overdraw, SDL_Point v0, SDL_Point v1, SDL_Point v2);
+
+// Visibility-buffer deferred shading. The first pass stores only the
+// depth and id, the triangle's index into the list later handed to
+// shade_visibility_buffer(). The vertices' z must be positive: depth is
+// interpolated as 1/z, which unlike z is linear in screen space.
+void draw_triangle_visibility(
+    VisibilityBuffer& vis,
+    const std::uint32_t id,
+    const Point3D& p0,
+    const Point3D& p1,
+    const Point3D& p2
+);
+
+// Second pass: shades each covered pixel once, like draw_shaded_triangle(),
+// using the color and interpolated h of the triangle whose ID it holds.
+// Other pixels are left alone. Returns the number of pixels shaded.
+std::size_t shade_visibility_buffer(
+    std::vector<std::uint32_t>& pixels,
+    const unsigned int width,
+    const VisibilityBuffer& vis,
+    const std::vector<Triangle3D>& tris,
+    const std::vector<std::uint32_t>& colors
+);
+
 #endif
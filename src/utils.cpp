@@ -1,10 +1,15 @@
 #include "utils.hpp"
 #include "constants.hpp"
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cassert>
 #include <cinttypes>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 void print_argb8888(const std::uint32_t color)
 {
     std::printf(" A R G B\n%" PRIX32 "\n", color);
@@ -52,3 +57,100 @@ void upscale(
 
     original.assign(upscale.begin(), upscale.end());
 }
+
+// Blends two ARGB8888 pixels with an 8-bit weight (0 = a, 256 = b).
+// Red and blue, then alpha and green, are blended two channels at a
+// time, with 16 bits of headroom for each channel.
+static std::uint32_t lerp_argb(const std::uint32_t a, const std::uint32_t b, const std::uint32_t w)
+{
+    const std::uint32_t rb = (((a & 0x00FF00FF) * (256 - w) + (b & 0x00FF00FF) * w) >> 8) & 0x00FF00FF;
+    const std::uint32_t ag = (((a >> 8) & 0x00FF00FF) * (256 - w) + ((b >> 8) & 0x00FF00FF) * w) & 0xFF00FF00;
+    return rb | ag;
+}
+
+void resize_bilinear(
+    const std::vector<std::uint32_t>& src,
+    const std::size_t src_width,
+    const std::size_t src_height,
+    std::vector<std::uint32_t>& dst
+) {
+    assert(src.size() == NUM_PIXELS);
+    assert(src_width > 0 && src_width <= SCREEN_WIDTH);
+    assert(src_height > 0 && src_height <= SCREEN_HEIGHT);
+    dst.resize(NUM_PIXELS);
+
+    // Source position of each destination column and row, in 8.8
+    // fixed point, sampled at pixel centers and clamped to the edges
+    auto source_positions = [](const std::size_t src_size, const std::size_t dst_size) {
+        std::vector<std::uint32_t> pos(dst_size);
+        const std::int64_t max_pos = static_cast<std::int64_t>(src_size - 1) * 256;
+        for (std::size_t i = 0; i < dst_size; i++) {
+            const std::int64_t p = ((2 * static_cast<std::int64_t>(i) + 1) * src_size * 256) / (2 * dst_size) - 128;
+            pos[i] = static_cast<std::uint32_t>(std::clamp<std::int64_t>(p, 0, max_pos));
+        }
+        return pos;
+    };
+    const std::vector<std::uint32_t> x_pos = source_positions(src_width, SCREEN_WIDTH);
+    const std::vector<std::uint32_t> y_pos = source_positions(src_height, SCREEN_HEIGHT);
+
+    // Each source row is filtered horizontally once and kept while
+    // the destination rows that blend it are produced
+    std::vector<std::uint32_t> rows[2] = {
+        std::vector<std::uint32_t>(SCREEN_WIDTH),
+        std::vector<std::uint32_t>(SCREEN_WIDTH)
+    };
+    std::size_t row_y[2] = {SIZE_MAX, SIZE_MAX};
+    auto filtered_row = [&](const std::size_t y) -> const std::vector<std::uint32_t>& {
+        for (int i = 0; i < 2; i++) {
+            if (row_y[i] == y) {
+                return rows[i];
+            }
+        }
+        // Replace the row that isn't y - 1, which may still be needed
+        const int slot = row_y[0] + 1 == y ? 1 : 0;
+        const std::uint32_t* s = src.data() + y * SCREEN_WIDTH;
+        for (std::size_t x = 0; x < SCREEN_WIDTH; x++) {
+            const std::uint32_t p = x_pos[x];
+            const std::size_t x0 = p >> 8;
+            const std::size_t x1 = std::min(x0 + 1, src_width - 1);
+            rows[slot][x] = lerp_argb(s[x0], s[x1], p & 0xFF);
+        }
+        row_y[slot] = y;
+        return rows[slot];
+    };
+
+    for (std::size_t y = 0; y < SCREEN_HEIGHT; y++) {
+        const std::uint32_t p = y_pos[y];
+        const std::size_t y0 = p >> 8;
+        const std::size_t y1 = std::min(y0 + 1, src_height - 1);
+        const std::uint32_t w = p & 0xFF;
+        std::uint32_t* d = dst.data() + y * SCREEN_WIDTH;
+        const std::vector<std::uint32_t>& top = filtered_row(y0);
+        if (w == 0) {
+            std::copy(top.begin(), top.end(), d);
+            continue;
+        }
+        const std::vector<std::uint32_t>& bottom = filtered_row(y1);
+        std::size_t x = 0;
+#if defined(__SSE2__)
+        // Four pixels at a time, one 16-bit lane per channel
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i w_top = _mm_set1_epi16(static_cast<short>(256 - w));
+        const __m128i w_bottom = _mm_set1_epi16(static_cast<short>(w));
+        for (; x + 4 <= SCREEN_WIDTH; x += 4) {
+            const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top.data() + x));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom.data() + x));
+            const __m128i lo = _mm_srli_epi16(_mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpacklo_epi8(t, zero), w_top),
+                _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w_bottom)), 8);
+            const __m128i hi = _mm_srli_epi16(_mm_add_epi16(
+                _mm_mullo_epi16(_mm_unpackhi_epi8(t, zero), w_top),
+                _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w_bottom)), 8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d + x), _mm_packus_epi16(lo, hi));
+        }
+#endif
+        for (; x < SCREEN_WIDTH; x++) {
+            d[x] = lerp_argb(top[x], bottom[x], w);
+        }
+    }
+}
@@ -21,4 +21,14 @@ void upscale(
     const std::size_t upscale_factor
 );
 
+// Scales the top-left src_width x src_height pixels of src to fill dst,
+// which is resized to the whole screen, using bilinear filtering.
+// Both buffers are SCREEN_WIDTH pixels wide.
+void resize_bilinear(
+    const std::vector<std::uint32_t>& src,
+    const std::size_t src_width,
+    const std::size_t src_height,
+    std::vector<std::uint32_t>& dst
+);
+
 #endif
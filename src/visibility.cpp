@@ -0,0 +1,97 @@
+#include "visibility.hpp"
+#include <algorithm>
+#include <limits>
+
+AttributePlane attribute_plane(
+    const SDL_Point& v0,
+    const SDL_Point& v1,
+    const SDL_Point& v2,
+    const float f0,
+    const float f1,
+    const float f2
+) {
+    const float e1x = static_cast<float>(v1.x - v0.x);
+    const float e1y = static_cast<float>(v1.y - v0.y);
+    const float e2x = static_cast<float>(v2.x - v0.x);
+    const float e2y = static_cast<float>(v2.y - v0.y);
+    const float area = e1x * e2y - e2x * e1y;
+    if (area == 0.0f) {
+        return {(f0 + f1 + f2) / 3.0f, 0.0f, 0.0f, v0.x, v0.y};
+    }
+    const float df1 = f1 - f0;
+    const float df2 = f2 - f0;
+    return {f0, (df1 * e2y - df2 * e1y) / area, (e1x * df2 - e2x * df1) / area, v0.x, v0.y};
+}
+
+VisibilityBuffer::VisibilityBuffer(const int width, const int height)
+    : w(width),
+      h(height),
+      depths(static_cast<std::size_t>(width) * height, std::numeric_limits<float>::infinity()),
+      triangle_ids(static_cast<std::size_t>(width) * height, NO_TRIANGLE),
+      row_min(height, width),
+      row_max(height, -1)
+{
+}
+
+void VisibilityBuffer::clear()
+{
+    for (int y = 0; y < h; y++) {
+        if (row_min[y] > row_max[y]) {
+            continue;
+        }
+        const std::size_t row = static_cast<std::size_t>(y) * w;
+        std::fill(depths.begin() + row + row_min[y], depths.begin() + row + row_max[y] + 1, std::numeric_limits<float>::infinity());
+        std::fill(triangle_ids.begin() + row + row_min[y], triangle_ids.begin() + row + row_max[y] + 1, NO_TRIANGLE);
+        row_min[y] = w;
+        row_max[y] = -1;
+    }
+}
+
+void VisibilityBuffer::insert(const int y, int x0, int x1, const AttributePlane& depth, const std::uint32_t id)
+{
+    if (y < 0 || y >= h) {
+        return;
+    }
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, w - 1);
+    if (x0 > x1) {
+        return;
+    }
+    row_min[y] = std::min(row_min[y], x0);
+    row_max[y] = std::max(row_max[y], x1);
+    const std::size_t row = static_cast<std::size_t>(y) * w;
+    float z = depth.at(x0, y);
+    for (int x = x0; x <= x1; x++, z += depth.dx) {
+        if (z < depths[row + x]) {
+            depths[row + x] = z;
+            triangle_ids[row + x] = id;
+        }
+    }
+}
+
+int VisibilityBuffer::width() const
+{
+    return w;
+}
+
+int VisibilityBuffer::height() const
+{
+    return h;
+}
+
+std::uint32_t VisibilityBuffer::id(const int x, const int y) const
+{
+    return triangle_ids[static_cast<std::size_t>(y) * w + x];
+}
+
+const std::vector<std::uint32_t>& VisibilityBuffer::ids() const
+{
+    return triangle_ids;
+}
+
+bool VisibilityBuffer::row_extent(const int y, int& x0, int& x1) const
+{
+    x0 = row_min[y];
+    x1 = row_max[y];
+    return x0 <= x1;
+}
@@ -0,0 +1,69 @@
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <SDL2/SDL.h>
+
+// A value interpolated linearly across a triangle in screen space:
+// f(x, y) = f0 + dx * (x - x0) + dy * (y - y0)
+struct AttributePlane {
+    float f0;
+    float dx;
+    float dy;
+    int x0;
+    int y0;
+
+    float at(const int x, const int y) const
+    {
+        return f0 + dx * (x - x0) + dy * (y - y0);
+    }
+};
+
+// Plane through the values f0, f1, f2 at the screen points v0, v1, v2.
+// For a triangle with no area, the plane is flat at their average.
+AttributePlane attribute_plane(
+    const SDL_Point& v0,
+    const SDL_Point& v1,
+    const SDL_Point& v2,
+    const float f0,
+    const float f1,
+    const float f2
+);
+
+// Visibility buffer: per pixel, the depth and ID of the nearest
+// triangle drawn so far, and nothing else. Once all geometry has been
+// inserted, a shading pass looks each visible triangle's attributes up
+// by ID and shades every covered pixel exactly once, however many
+// triangles were drawn over it. Each row tracks the extent that has
+// been drawn to, so clearing and shading skip untouched pixels.
+class VisibilityBuffer {
+public:
+    static constexpr std::uint32_t NO_TRIANGLE = 0xFFFFFFFF;
+
+    VisibilityBuffer(const int width, const int height);
+
+    // Only resets the pixels drawn to since the last clear
+    void clear();
+    // Depth-tests pixels x0 to x1 inclusive of row y against depth,
+    // smaller being nearer, and stores id where it passes
+    void insert(const int y, int x0, int x1, const AttributePlane& depth, const std::uint32_t id);
+
+    int width() const;
+    int height() const;
+    std::uint32_t id(const int x, const int y) const;
+    const std::vector<std::uint32_t>& ids() const;
+    // Inclusive range of row y drawn to; false if the row is untouched
+    bool row_extent(const int y, int& x0, int& x1) const;
+
+private:
+    int w;
+    int h;
+    std::vector<float> depths;
+    std::vector<std::uint32_t> triangle_ids;
+    std::vector<int> row_min;
+    std::vector<int> row_max;
+};
+
+#endif
@@ -0,0 +1,101 @@
+// Headless overdraw and cost heatmaps of a triangle soup.
+//
+// Usage: ./overdrawdump [triangles] [prefix]
+//
+// Draws random overlapping triangles of mixed sizes straight into a
+// framebuffer, as the direct rasterizer does, and counts the writes to
+// every pixel. Each triangle's cost is measured in cycles when hardware
+// counters are available, and in nanoseconds otherwise. Prints overdraw
+// statistics and the costliest tiles, and writes prefix_writes.ppm and
+// prefix_cost.ppm.
+
+#include "constants.hpp"
+#include "overdraw.hpp"
+#include "perfcounters.hpp"
+#include "triangle.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000;
+    const std::string prefix = argc > 2 ? argv[2] : "overdraw";
+
+    std::mt19937 rng(41);
+    std::uniform_int_distribution<int> rand_x(0, SCREEN_WIDTH - 1);
+    std::uniform_int_distribution<int> rand_y(0, SCREEN_HEIGHT - 1);
+    // Mostly small triangles, a few large ones
+    std::uniform_real_distribution<float> rand_size(0.0f, 1.0f);
+    auto clamp_point = [](const int x, const int y) -> SDL_Point {
+        return {std::clamp(x, 0, SCREEN_WIDTH - 1), std::clamp(y, 0, SCREEN_HEIGHT - 1)};
+    };
+
+    std::vector<std::uint32_t> pixels(NUM_PIXELS, COLOR_BLANK.raw);
+    OverdrawMap overdraw(SCREEN_WIDTH, SCREEN_HEIGHT);
+    PerfCounters perf;
+    const bool cycles = perf.available();
+    std::size_t failed_reads = 0;
+
+    for (std::size_t i = 0; i < count; i++) {
+        const int extent = 4 + static_cast<int>(300.0f * std::pow(rand_size(rng), 8.0f));
+        std::uniform_int_distribution<int> offset(-extent, extent);
+        const int cx = rand_x(rng);
+        const int cy = rand_y(rng);
+        const SDL_Point a = clamp_point(cx + offset(rng), cy + offset(rng));
+        const SDL_Point b = clamp_point(cx + offset(rng), cy + offset(rng));
+        const SDL_Point c = clamp_point(cx + offset(rng), cy + offset(rng));
+        if (a.y == b.y && b.y == c.y) {
+            continue;
+        }
+
+        const PerfReading before = perf.read();
+        const auto start = std::chrono::steady_clock::now();
+        draw_filled_triangle_bres(pixels, SCREEN_WIDTH, 0xFF000000 | static_cast<std::uint32_t>(i), a, b, c);
+        const auto end = std::chrono::steady_clock::now();
+        const PerfReading after = perf.read();
+
+        draw_filled_triangle_overdraw(overdraw, a, b, c);
+        const PerfReading delta = after.since(before);
+        if (cycles && !delta.valid) {
+            failed_reads++;
+            overdraw.add_cost(0.0);
+        } else if (cycles) {
+            overdraw.add_cost(static_cast<double>(delta[PerfEvent::cycles]));
+        } else {
+            overdraw.add_cost(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+    }
+
+    const OverdrawStats stats = overdraw.stats(10);
+    std::cout << stats.writes << " writes to " << stats.covered << " pixels, average overdraw "
+              << stats.average << ", max " << stats.max << " writes to one pixel" << std::endl;
+    if (!cycles) {
+        std::cout << "Hardware counters unavailable (" << perf.reason() << "), cost is in ns" << std::endl;
+    }
+    if (failed_reads > 0) {
+        std::cout << failed_reads << " counter reads failed; those triangles add no cost" << std::endl;
+    }
+    std::cout << "Costliest " << OverdrawMap::TILE_SIZE << "x" << OverdrawMap::TILE_SIZE << " tiles:" << std::endl;
+    for (const OverdrawTile& tile : stats.hottest) {
+        std::cout << "  (" << tile.x << ", " << tile.y << "): " << tile.writes << " writes, "
+                  << static_cast<long long>(tile.cost) << (cycles ? " cycles" : " ns") << std::endl;
+    }
+
+    try {
+        overdraw.draw_heatmap(pixels);
+        write_ppm(prefix + "_writes.ppm", pixels, SCREEN_WIDTH, SCREEN_HEIGHT);
+        overdraw.draw_cost_heatmap(pixels);
+        write_ppm(prefix + "_cost.ppm", pixels, SCREEN_WIDTH, SCREEN_HEIGHT);
+    } catch (std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
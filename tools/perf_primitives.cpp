@@ -0,0 +1,199 @@
+// Hardware-counter profile of the rasterizer's primitives.
+//
+// Usage: ./perfprims [repeats]
+//
+// Draws batches of each primitive into a full-screen ARGB8888 buffer
+// and reports, per batch type, cycles, IPC and L1D/LLC/branch misses
+// per pixel written, so memory-bound primitives stand out from
+// compute-bound ones. Steep and gentle lines are measured separately:
+// steep lines step a whole SCREEN_WIDTH row per pixel. Without
+// hardware counters only the wall time is reported.
+
+#include "constants.hpp"
+#include "framesink.hpp"
+#include "layers.hpp"
+#include "line.hpp"
+#include "perfcounters.hpp"
+#include "spanbuffer.hpp"
+#include "triangle.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    const int repeats = argc > 1 ? std::max(1, std::atoi(argv[1])) : 3;
+
+    std::vector<std::uint32_t> pixels(NUM_PIXELS, COLOR_BLANK.raw);
+    std::mt19937 rng(40);
+    std::uniform_int_distribution<int> rand_x(0, SCREEN_WIDTH - 1);
+    std::uniform_int_distribution<int> rand_y(0, SCREEN_HEIGHT - 1);
+    StageProfiler profiler;
+
+    // Runs draw() repeats times as one stage; draw returns pixels written.
+    // Pixel counts that need extra work, such as a second edge walk, are
+    // computed beforehand so that they aren't counted as the stage's cost.
+    auto measure = [&](const char* stage, const std::function<std::uint64_t()>& draw) {
+        draw(); // Warm caches and fault in pages outside the measurement
+        for (int r = 0; r < repeats; r++) {
+            profiler.begin();
+            const std::uint64_t written = draw();
+            profiler.end(stage, written);
+        }
+    };
+
+    struct Line {
+        int ax;
+        int ay;
+        int bx;
+        int by;
+    };
+    auto make_lines = [&](const bool steep) {
+        std::vector<Line> lines(20000);
+        std::uniform_int_distribution<int> minor(-100, 100);
+        for (Line& l : lines) {
+            l.ax = rand_x(rng);
+            l.ay = rand_y(rng);
+            if (steep) {
+                l.bx = std::clamp(l.ax + minor(rng), 0, SCREEN_WIDTH - 1);
+                l.by = rand_y(rng);
+            } else {
+                l.bx = rand_x(rng);
+                l.by = std::clamp(l.ay + minor(rng), 0, SCREEN_HEIGHT - 1);
+            }
+        }
+        return lines;
+    };
+    auto count_line_pixels = [](const std::vector<Line>& lines) {
+        std::uint64_t written = 0;
+        for (const Line& l : lines) {
+            written += std::max(std::abs(l.bx - l.ax), std::abs(l.by - l.ay)) + 1;
+        }
+        return written;
+    };
+    auto draw_lines = [&](const std::vector<Line>& lines) {
+        for (const Line& l : lines) {
+            draw_line_bresenham(pixels, COLOR_BLUE.raw, l.ax, l.ay, l.bx, l.by);
+        }
+    };
+    const std::vector<Line> gentle_lines = make_lines(false);
+    const std::vector<Line> steep_lines = make_lines(true);
+    const std::uint64_t gentle_pixels = count_line_pixels(gentle_lines);
+    const std::uint64_t steep_pixels = count_line_pixels(steep_lines);
+    measure("lines, gentle", [&]() { draw_lines(gentle_lines); return gentle_pixels; });
+    measure("lines, steep", [&]() { draw_lines(steep_lines); return steep_pixels; });
+
+    auto make_triangles = [&](const int size, const std::size_t count) {
+        std::vector<Triangle2D> tris;
+        std::uniform_int_distribution<int> offset(0, size);
+        while (tris.size() < count) {
+            const int x = std::uniform_int_distribution<int>(0, SCREEN_WIDTH - 1 - size)(rng);
+            const int y = std::uniform_int_distribution<int>(0, SCREEN_HEIGHT - 1 - size)(rng);
+            const Triangle2D t = {
+                {x + offset(rng), y + offset(rng)},
+                {x + offset(rng), y + offset(rng)},
+                {x + offset(rng), y + offset(rng)}
+            };
+            // Skip triangles whose vertices all share one row
+            if (t.a.y != t.b.y || t.b.y != t.c.y) {
+                tris.push_back(t);
+            }
+        }
+        return tris;
+    };
+    auto count_triangle_pixels = [](const std::vector<Triangle2D>& tris) {
+        std::uint64_t written = 0;
+        for (const Triangle2D& t : tris) {
+            written += count_filled_triangle_pixels(t.a, t.b, t.c);
+        }
+        return written;
+    };
+    auto draw_triangles = [&](const std::vector<Triangle2D>& tris) {
+        for (const Triangle2D& t : tris) {
+            draw_filled_triangle_bres(pixels, SCREEN_WIDTH, COLOR_GREEN.raw, t.a, t.b, t.c);
+        }
+    };
+    const std::vector<Triangle2D> small_tris = make_triangles(7, 100000);
+    const std::vector<Triangle2D> large_tris = make_triangles(300, 1000);
+    const std::uint64_t small_pixels = count_triangle_pixels(small_tris);
+    const std::uint64_t large_pixels = count_triangle_pixels(large_tris);
+    measure("triangles, 8px box", [&]() { draw_triangles(small_tris); return small_pixels; });
+    measure("triangles, 300px box", [&]() { draw_triangles(large_tris); return large_pixels; });
+
+    // draw_shaded_triangle takes coordinates relative to the screen center
+    std::vector<Triangle3D> shaded_tris;
+    for (std::size_t i = 0; i < large_tris.size(); i++) {
+        const Triangle2D& t = large_tris[i];
+        const float z = static_cast<float>(i % 97 + 1);
+        auto centered = [&](const SDL_Point& p, const float h) -> Point3D {
+            return {static_cast<float>(p.x - X_MID_SCREEN), static_cast<float>(Y_MID_SCREEN - p.y), z, h};
+        };
+        shaded_tris.push_back({centered(t.a, 0.2f), centered(t.b, 0.6f), centered(t.c, 1.0f)});
+    }
+    std::uint64_t shaded_pixels = 0;
+    for (const Triangle3D& t : shaded_tris) {
+        shaded_pixels += count_filled_triangle_pixels(project_special(t.a), project_special(t.b), project_special(t.c));
+    }
+    measure("triangles, shaded", [&]() {
+        for (const Triangle3D& t : shaded_tris) {
+            draw_shaded_triangle(pixels, SCREEN_WIDTH, COLOR_GREEN.raw, t.a, t.b, t.c);
+        }
+        return shaded_pixels;
+    });
+
+    // The same triangles through a visibility buffer: pixels counts the
+    // pixels shaded, so compare the time, not the per-pixel columns
+    VisibilityBuffer vis(SCREEN_WIDTH, SCREEN_HEIGHT);
+    const std::vector<std::uint32_t> shaded_colors(shaded_tris.size(), COLOR_GREEN.raw);
+    measure("shaded, visibility buffer", [&]() {
+        vis.clear();
+        for (std::size_t i = 0; i < shaded_tris.size(); i++) {
+            const Triangle3D& t = shaded_tris[i];
+            draw_triangle_visibility(vis, static_cast<std::uint32_t>(i), t.a, t.b, t.c);
+        }
+        return static_cast<std::uint64_t>(shade_visibility_buffer(pixels, SCREEN_WIDTH, vis, shaded_tris, shaded_colors));
+    });
+
+    SpanBuffer spans(SCREEN_WIDTH, SCREEN_HEIGHT);
+    auto draw_spans = [&]() {
+        spans.clear();
+        for (std::size_t i = 0; i < large_tris.size(); i++) {
+            const Triangle2D& t = large_tris[i];
+            draw_filled_triangle_spans(spans, COLOR_RED.raw, static_cast<float>(i % 97), t.a, t.b, t.c);
+        }
+        spans.resolve(pixels);
+    };
+    // Each pixel is resolved once however many triangles cover it
+    draw_spans();
+    const std::uint64_t span_pixels = spans.pixel_count();
+    measure("span buffer + resolve", [&]() { draw_spans(); return span_pixels; });
+
+    std::vector<std::uint32_t> layer(NUM_PIXELS);
+    for (std::size_t i = 0; i < layer.size(); i++) {
+        layer[i] = (static_cast<std::uint32_t>(i % 256) << 24) | 0x00336699;
+    }
+    measure("blend_over", [&]() {
+        blend_over(pixels.data(), layer.data(), NUM_PIXELS);
+        return static_cast<std::uint64_t>(NUM_PIXELS);
+    });
+
+    std::vector<std::uint32_t> resized;
+    measure("resize_bilinear 960x540", [&]() {
+        resize_bilinear(pixels, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, resized);
+        return static_cast<std::uint64_t>(NUM_PIXELS);
+    });
+
+    std::vector<std::uint8_t> yuv(NUM_PIXELS * 3 / 2);
+    measure("argb_to_yuv420", [&]() {
+        argb_to_yuv420(pixels.data(), SCREEN_WIDTH, SCREEN_HEIGHT, yuv.data());
+        return static_cast<std::uint64_t>(NUM_PIXELS);
+    });
+
+    profiler.report(std::cout);
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Reader for frames exported with ./rasterizer --shm NAME.
+//
+// Usage: ./shmreader NAME [seconds]
+//        ./shmreader --selftest [seconds]
+//
+// The first form attaches to a running rasterizer and reads frames in
+// place, with no copy, reporting how many arrived, how many the writer
+// overwrote while they were being read, and how many were skipped.
+//
+// The second form forks a writer that publishes small frames as fast
+// as it can, every pixel holding the frame number, and checks that no
+// frame the seqlock accepts mixes pixels from two frames. Every few
+// frames the reader stalls halfway through a frame, so the writer laps
+// it even on a single core. It exits with status 1 if any torn frame
+// gets through.
+
+#include "sharedframes.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct ReadStats {
+    std::uint64_t frames = 0;
+    std::uint64_t overwritten = 0;
+    std::uint64_t skipped = 0;
+    std::uint64_t torn = 0;
+    std::uint64_t copies = 0;
+    double seconds = 0.0;
+};
+
+// Reads frames for the given time. If check_pattern is set, every
+// pixel of frame n must equal n (truncated to 32 bits), and every
+// eighth frame is read slowly.
+static ReadStats read_frames(SharedFrameReader& reader, const double seconds, const bool check_pattern)
+{
+    ReadStats stats;
+    const std::size_t count = static_cast<std::size_t>(reader.width()) * reader.height();
+    std::vector<std::uint32_t> copy;
+    std::uint64_t prev_number = 0;
+    volatile std::uint32_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&]() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    while (elapsed() < seconds) {
+        if (!reader.wait_for_frame(100)) {
+            continue;
+        }
+        const SharedFrameReader::Frame frame = reader.acquire();
+        if (frame.pixels == nullptr) {
+            continue;
+        }
+        bool consistent = true;
+        std::uint32_t sum = 0;
+        const std::uint32_t expected = static_cast<std::uint32_t>(frame.number);
+        const bool stall = check_pattern && frame.number % 8 == 0;
+        for (std::size_t i = 0; i < count; i++) {
+            if (stall && i == count / 2) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            sum += frame.pixels[i];
+            consistent &= frame.pixels[i] == expected;
+        }
+        checksum = checksum + sum;
+        if (!reader.release(frame)) {
+            stats.overwritten++;
+            continue;
+        }
+        stats.frames++;
+        if (check_pattern && !consistent) {
+            stats.torn++;
+        }
+        if (prev_number != 0 && frame.number > prev_number + 1) {
+            stats.skipped += frame.number - prev_number - 1;
+        }
+        prev_number = frame.number;
+
+        // Exercise the copying path too
+        if (check_pattern && stats.frames % 16 == 0) {
+            std::uint64_t number = 0;
+            if (reader.read(copy, &number)) {
+                stats.copies++;
+                for (const std::uint32_t p : copy) {
+                    if (p != static_cast<std::uint32_t>(number)) {
+                        stats.torn++;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    stats.seconds = elapsed();
+    return stats;
+}
+
+static void print_stats(const ReadStats& stats)
+{
+    std::printf("%llu frames in %.1f s (%.1f fps), %llu overwritten while reading, %llu skipped",
+        static_cast<unsigned long long>(stats.frames), stats.seconds, stats.frames / stats.seconds,
+        static_cast<unsigned long long>(stats.overwritten), static_cast<unsigned long long>(stats.skipped));
+    if (stats.copies > 0) {
+        std::printf(", %llu copies", static_cast<unsigned long long>(stats.copies));
+    }
+    std::printf("\n");
+}
+
+static int self_test(const double seconds)
+{
+    static constexpr int width = 320;
+    static constexpr int height = 180;
+    const std::string name = "/rasterizer-selftest-" + std::to_string(getpid());
+    SharedFrameWriter writer(name, width, height, 2);
+
+    const pid_t child = fork();
+    if (child < 0) {
+        throw std::runtime_error("fork failed");
+    }
+    if (child == 0) {
+        // Writer: draw straight into the shared slots, as fast as possible
+        std::uint64_t number = writer.frames_published();
+        while (true) {
+            std::uint32_t* pixels = writer.begin_frame();
+            number++;
+            std::fill(pixels, pixels + width * height, static_cast<std::uint32_t>(number));
+            writer.end_frame();
+        }
+    }
+
+    ReadStats stats;
+    {
+        SharedFrameReader reader(name);
+        stats = read_frames(reader, seconds, true);
+    }
+    kill(child, SIGKILL);
+    waitpid(child, nullptr, 0);
+
+    print_stats(stats);
+    std::printf("%llu torn frames\n", static_cast<unsigned long long>(stats.torn));
+    return stats.torn == 0 && stats.frames > 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3) {
+        std::fprintf(stderr, "Usage: %s NAME|--selftest [seconds]\n", argv[0]);
+        return 1;
+    }
+    const double seconds = argc > 2 ? std::atof(argv[2]) : 5.0;
+
+    try {
+        if (std::strcmp(argv[1], "--selftest") == 0) {
+            return self_test(seconds);
+        }
+        SharedFrameReader reader(argv[1]);
+        std::printf("%s: %dx%d\n", argv[1], reader.width(), reader.height());
+        print_stats(read_frames(reader, seconds, false));
+    } catch (std::runtime_error& e) {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}